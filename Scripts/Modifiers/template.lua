@@ -1,3 +1,9 @@
+function isPure()
+	-- Return true only if stat functions depend on 'prev' value and parameters only.
+	-- Their results are cached then, see luaApi.md for details.
+	return false
+end
+
 function canApplyAsLowerSpell()
 	return false
 end
@@ -22,10 +22,12 @@
 
 #include "d2pair.h"
 #include "d2set.h"
+#include <cstdint>
 
 namespace game {
 struct CMidgardID;
 struct BattleMsgData;
+struct UnitInfo;
 struct IMidgardObjectMap;
 
 using TargetSet = Set<int>;
@@ -52,6 +54,22 @@ game::BattleMsgData* __fastcall battleMsgDataCopyHooked(game::BattleMsgData* thi
 
 void __fastcall battleMsgDataDtorHooked(game::BattleMsgData* thisptr, int /*%edx*/);
 
+/**
+ * Makes modified units of the battle data safe to change.
+ * Battle data copies share modified units until one of the copies changes them.
+ */
+void makeModifiedUnitsUnique(game::BattleMsgData* battleMsgData);
+
+/**
+ * Returns occupancy mask of patched modified units of the unit.
+ * Bit is set for each modified unit slot with valid unit id.
+ * Mask is available only when unrestrictedBestowWards is enabled.
+ */
+std::uint64_t& getModifiedUnitsOccupancy(game::UnitInfo* unitInfo);
+
+/** Recomputes occupancy mask after patched modified units were changed directly. */
+void updateModifiedUnitsOccupancy(game::UnitInfo* unitInfo);
+
 void __fastcall removeUnitInfoHooked(game::BattleMsgData* thisptr,
                                      int /*%edx*/,
                                      const game::CMidgardID* unitId);
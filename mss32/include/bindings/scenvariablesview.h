@@ -20,10 +20,9 @@
 #ifndef SCENVARIABLESVIEW_H
 #define SCENVARIABLESVIEW_H
 
-#include "midscenvariables.h"
+#include "scenvariablesindex.h"
 #include <optional>
 #include <string>
-#include <unordered_map>
 
 namespace sol {
 class state;
@@ -43,8 +42,7 @@ public:
     std::optional<ScenarioVariableView> getScenarioVariable(const std::string& name) const;
 
 private:
-    std::unordered_map<std::string, const game::ScenarioVariable*> variables;
-    const game::CMidScenVariables* scenVariables;
+    hooks::ScenarioVariablesIndexPtr index;
 };
 
 } // namespace bindings
@@ -0,0 +1,50 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Stanislav Egorov.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CUSTOMATTACKREACHFUNCTIONS_H
+#define CUSTOMATTACKREACHFUNCTIONS_H
+
+#include <lua.hpp>
+#include <optional>
+#include <sol/sol.hpp>
+
+namespace hooks {
+
+struct CustomAttackReach;
+
+struct CustomAttackReachFunctions
+{
+    CustomAttackReachFunctions(const CustomAttackReach& attackReach);
+
+    std::optional<sol::environment> selectionEnvironment;
+    std::optional<sol::environment> attackEnvironment;
+    std::optional<sol::function> getSelectionTargets;
+    std::optional<sol::function> getAttackTargets;
+};
+
+/**
+ * Returns script functions of custom attack reach resolved in lua state of the calling thread.
+ * Scripts are executed only once per lua state, subsequent calls reuse the same functions.
+ */
+const CustomAttackReachFunctions& getCustomAttackReachFunctions(
+    const CustomAttackReach& attackReach);
+
+} // namespace hooks
+
+#endif // CUSTOMATTACKREACHFUNCTIONS_H
@@ -22,6 +22,7 @@
 
 #include "attackreachcat.h"
 #include "attacksourcecat.h"
+#include "luastates.h"
 #include "midgardid.h"
 #include <map>
 #include <string>
@@ -34,6 +35,7 @@ static const char damageRatioPerTargetColumnName[] = "DR_REPEAT";
 static const char damageSplitColumnName[] = "DAM_SPLIT";
 static const char critDamageColumnName[] = "CRIT_DAM";
 static const char critPowerColumnName[] = "CRIT_POWER";
+static const char aiRatingColumnName[] = "AI_RATING";
 
 struct CustomAttackData
 {
@@ -55,6 +57,8 @@ struct CustomAttackSource
 
 using CustomAttackSources = std::vector<CustomAttackSource>;
 
+struct CustomAttackReachFunctions;
+
 struct CustomAttackReach
 {
     game::LAttackReach reach;
@@ -66,6 +70,8 @@ struct CustomAttackReach
     bool markAttackTargets;
     bool melee;
     std::uint32_t maxTargets;
+    // Resolved lazily in a corresponding thread, live as long as its Lua instance
+    mutable OwnedLuaStateObjects<CustomAttackReachFunctions> functions;
 };
 
 using CustomAttackReaches = std::vector<CustomAttackReach>;
@@ -76,6 +82,8 @@ struct CustomAttacks
 {
     CustomAttackSources sources;
     CustomAttackReaches reaches;
+    std::vector<const CustomAttackReach*> reachesById; // Custom reaches or nullptr for base ones
+    std::vector<double> attackClassAiRatings;         // Mapped by attack class id
     std::map<game::CMidgardID, CustomAttackDamageRatios> damageRatios; // Mapped by attack id
     std::vector<game::CMidgardID> targets;
     struct
@@ -32,6 +32,7 @@ struct IMidgardObjectMap;
 struct BattleMsgData;
 struct IAttack;
 struct IBatAttack;
+enum class AttackReachId : int;
 } // namespace game
 
 namespace bindings {
@@ -51,7 +52,24 @@ void fillCustomAttackSources(const std::filesystem::path& dbfFilePath);
 
 void fillCustomAttackReaches(const std::filesystem::path& dbfFilePath);
 
-UnitSlots getTargetsToSelectOrAttack(const std::string& scriptFile,
+/**
+ * Reads AI ratings of attack classes from LAttC.dbf.
+ * Ratings can be overridden by optional AI_RATING column, default game values are used otherwise.
+ */
+void fillAttackClassAiRatings(const std::filesystem::path& dbfFilePath);
+
+/** Maps attack reach ids to custom reaches. Reach categories should be read at this point. */
+void fillCustomAttackReachesById();
+
+/** Returns custom attack reach by its id or nullptr for base reaches. */
+const CustomAttackReach* findCustomAttackReach(game::AttackReachId id);
+
+/**
+ * Calls 'getTargets' function of custom attack reach selection or attack script.
+ * @param[in] selection true to call selection script, false to call attack script.
+ */
+UnitSlots getTargetsToSelectOrAttack(const CustomAttackReach& attackReach,
+                                     bool selection,
                                      const bindings::UnitSlotView& attacker,
                                      const bindings::UnitSlotView& selected,
                                      const UnitSlots& allies,
@@ -61,9 +79,16 @@ UnitSlots getTargetsToSelectOrAttack(const std::string& scriptFile,
                                      const bindings::BattleMsgDataView& battle,
                                      bool isMarking);
 
+/**
+ * Increases version of battle state that cached targets of custom attack reaches are bound to.
+ * Must be called wherever battle data or state of units in battle changes.
+ */
+void increaseBattleVersion();
+
 UnitSlots getTargets(const game::IMidgardObjectMap* objectMap,
                      const game::BattleMsgData* battleMsgData,
                      const game::IBatAttack* batAttack,
+                     const game::IAttack* attack,
                      const game::CMidgardID* targetGroupId,
                      const game::CMidgardID* unitId,
                      const game::CMidgardID* selectedUnitId);
@@ -76,6 +101,7 @@ UnitSlots getAllies(const game::IMidgardObjectMap* objectMap,
 void fillTargetsListForCustomAttackReach(const game::IMidgardObjectMap* objectMap,
                                          const game::BattleMsgData* battleMsgData,
                                          const game::IBatAttack* batAttack,
+                                         const game::IAttack* attack,
                                          const game::CMidgardID* targetGroupId,
                                          const game::CMidgardID* unitGroupId,
                                          const game::CMidgardID* unitId,
@@ -94,6 +120,7 @@ void getTargetsToAttackForAllAttackReach(const game::IMidgardObjectMap* objectMa
 UnitSlots getTargetsToMarkOrAttackForCustomAttackReach(const game::IMidgardObjectMap* objectMap,
                                                        const game::BattleMsgData* battleMsgData,
                                                        const game::IBatAttack* batAttack,
+                                                       const game::IAttack* attack,
                                                        const game::CMidgardID* targetGroupId,
                                                        const game::CMidgardID* targetUnitId,
                                                        const game::CMidgardID* unitGroupId,
@@ -104,6 +131,7 @@ UnitSlots getTargetsToMarkOrAttackForCustomAttackReach(const game::IMidgardObjec
 UnitSlots getTargetsToAttackForCustomAttackReach(const game::IMidgardObjectMap* objectMap,
                                                  const game::BattleMsgData* battleMsgData,
                                                  const game::IBatAttack* batAttack,
+                                                 const game::IAttack* attack,
                                                  const game::CMidgardID* targetGroupId,
                                                  const game::CMidgardID* targetUnitId,
                                                  const game::CMidgardID* unitGroupId,
@@ -123,6 +151,7 @@ UnitSlots getTargetsToMarkForCustomAttackReach(const game::IMidgardObjectMap* ob
 void getTargetsToAttackForCustomAttackReach(const game::IMidgardObjectMap* objectMap,
                                             const game::BattleMsgData* battleMsgData,
                                             const game::IBatAttack* batAttack,
+                                            const game::IAttack* attack,
                                             const game::CMidgardID* targetGroupId,
                                             const game::CMidgardID* targetUnitId,
                                             const game::CMidgardID* unitGroupId,
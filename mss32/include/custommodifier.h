@@ -27,8 +27,14 @@
 #include "umunit.h"
 #include "unitview.h"
 #include "usstackleader.h"
+#include <array>
+#include <atomic>
 #include <map>
 #include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
 
 namespace game {
 
@@ -46,6 +52,25 @@ struct CAttackModifiedCustom : public game::IAttack
     const game::IAttack* prev;
 };
 
+/** Maximum number of cached pure function results per modifier and thread. */
+constexpr std::size_t maxPureValues = 256;
+
+/** Function name, parameter and previous value of pure script function call. */
+using PureValueKey = std::tuple<const char*, int, int>;
+using PureValues = std::map<PureValueKey, int>;
+
+/**
+ * Stat values returned by getAllStats script function, mapped by per-stat function names.
+ * Values are reused only within a single stat query that produced them,
+ * so they never outlive unit, modifiers or scenario state they were computed from.
+ */
+struct CustomModifierAllStats
+{
+    std::uint32_t queryId;
+    const game::IUsUnit* prev;
+    std::map<std::string, int, std::less<>> values;
+};
+
 struct CustomModifierData
 {
     game::ModifierElementTypeFlag lastElementQuery;
@@ -55,9 +80,32 @@ struct CustomModifierData
     game::Bank trainingCost;
     game::IdVector wards;
     int regen;
+    PureValues pureValues;
+    CustomModifierAllStats allStats;
+};
+
+/**
+ * Number of threads that access custom modifier data without locking.
+ * Slots are assigned to threads on first access and are not tied to Lua instances.
+ * Slot of a thread is reused by other threads after it exits.
+ */
+constexpr std::size_t maxCustomModifierDataSlots = 16;
+
+using CustomModifierDataSlots = std::array<CustomModifierData*, maxCustomModifierDataSlots>;
+/** Data of threads that got no slot, by slot indices past maxCustomModifierDataSlots. */
+using CustomModifierDataMap = std::map<std::size_t, CustomModifierData*>;
+
+/** Counts custom modifier script calls, only in debug mode. */
+struct CustomModifierStatistics
+{
+    std::atomic<std::uint32_t> scriptCalls;
+    std::atomic<std::uint32_t> cachedCalls;
 };
 
-using CustomModifierDataMap = std::map<std::thread::id, CustomModifierData>;
+CustomModifierStatistics& getCustomModifierStatistics();
+
+/** Counts custom modifier script call or cache hit if debug mode is enabled. */
+void countScriptCall(bool cached);
 
 struct CCustomModifier
 {
@@ -73,11 +121,13 @@ struct CCustomModifier
     const std::string scriptFileName;
     const game::CMidgardID descTxt;
     const bool display;
-    // Thread-sensitive data
-    CustomModifierDataMap data;
-    std::mutex dataMutex;
+    // Thread-sensitive data, each thread uses its own slot.
+    // Threads that got no slot use the map
+    mutable CustomModifierDataSlots data;
+    mutable CustomModifierDataMap dataMap;
+    mutable std::mutex dataMutex;
 
-    CustomModifierData& getData();
+    CustomModifierData& getData() const;
     void setUnit(const game::CMidUnit* value);
     game::IAttack* getAttack(bool primary);
     game::IAttack* wrapAltAttack(const game::IAttack* value);
@@ -97,6 +147,38 @@ struct CCustomModifier
     void showScriptErrorMessage(const char* functionName, const char* reason) const;
     void showInvalidRetvalMessage(const char* functionName, const char* reason) const;
     void notifyModifiersChanged() const;
+    bool isPure() const;
+    /** Returns stat value from getAllStats script function, if the function returned it. */
+    std::optional<int> getAllStatsValue(const char* functionName) const;
+
+    /**
+     * Returns cached result of pure script function, calls the function on cache miss.
+     * Only integral results of modifiers that declared themselves pure are cached.
+     * The cache is cleared in notifyModifiersChanged, but not on battle state changes:
+     * results of pure functions depend only on the parameter and previous value,
+     * so they stay valid regardless of unit or battle state changes.
+     */
+    template <typename C>
+    int getPureValue(const char* functionName, int param, int prev, C call) const
+    {
+        auto& values = getData().pureValues;
+
+        const PureValueKey key{functionName, param, prev};
+        auto it = values.find(key);
+        if (it != values.end()) {
+            countScriptCall(true);
+            return it->second;
+        }
+
+        countScriptCall(false);
+        const int value = call();
+        if (values.size() >= maxPureValues) {
+            values.clear();
+        }
+
+        values[key] = value;
+        return value;
+    }
 
     game::CMidgardID getUnitNameTxt() const;
     game::CMidgardID getUnitBaseNameTxt() const;
@@ -109,10 +191,29 @@ struct CCustomModifier
     game::CMidgardID getAttackBaseDescTxt(const game::IAttack* attack) const;
 
     template <typename F, typename T>
-    T getValue(F function, const char* functionName, const T& prev) const
+    T getValue(const F& function, const char* functionName, const T& prev) const
     {
+        const LuaLease lease;
         try {
+            if constexpr (std::is_integral_v<T>) {
+                const auto value = getAllStatsValue(functionName);
+                if (value) {
+                    return (T)*value;
+                }
+            }
+
             if (function) {
+                if constexpr (std::is_integral_v<T>) {
+                    if (isPure()) {
+                        return (T)getPureValue(functionName, 0, (int)prev, [&]() {
+                            bindings::UnitView unitView{unit, getPrev()};
+                            const T value = (*function)(unitView, prev);
+                            return (int)value;
+                        });
+                    }
+                }
+
+                countScriptCall(false);
                 bindings::UnitView unitView{unit, getPrev()};
                 return (*function)(unitView, prev);
             }
@@ -124,10 +225,12 @@ struct CCustomModifier
     }
 
     template <typename F, typename T>
-    T getValueAs(F function, const char* functionName, const T& prev) const
+    T getValueAs(const F& function, const char* functionName, const T& prev) const
     {
+        const LuaLease lease;
         try {
             if (function) {
+                countScriptCall(false);
                 bindings::UnitView unitView{unit, getPrev()};
                 sol::table result = (*function)(unitView, prev);
                 return result.as<T>();
@@ -140,10 +243,25 @@ struct CCustomModifier
     }
 
     template <typename F, typename T, typename P>
-    T getValueParam(F function, const char* functionName, const P& param, const T& prev) const
+    T getValueParam(const F& function,
+                    const char* functionName,
+                    const P& param,
+                    const T& prev) const
     {
+        const LuaLease lease;
         try {
             if (function) {
+                if constexpr (std::is_integral_v<T> && std::is_integral_v<P>) {
+                    if (isPure()) {
+                        return (T)getPureValue(functionName, (int)param, (int)prev, [&]() {
+                            bindings::UnitView unitView{unit, getPrev()};
+                            const T value = (*function)(unitView, param, prev);
+                            return (int)value;
+                        });
+                    }
+                }
+
+                countScriptCall(false);
                 bindings::UnitView unitView{unit, getPrev()};
                 return (*function)(unitView, param, prev);
             }
@@ -155,10 +273,12 @@ struct CCustomModifier
     }
 
     template <typename F, typename T>
-    T getValueNoParam(F function, const char* functionName, T def) const
+    T getValueNoParam(const F& function, const char* functionName, T def) const
     {
+        const LuaLease lease;
         try {
             if (function) {
+                countScriptCall(false);
                 return (*function)();
             }
         } catch (const std::exception& e) {
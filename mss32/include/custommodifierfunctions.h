@@ -32,7 +32,10 @@ struct CustomModifierFunctions
     CustomModifierFunctions(const std::string& scriptFileName);
 
     std::optional<sol::environment> environment;
+    /** Script declared its stat functions to depend only on parameter and previous value. */
+    bool pure{};
     std::optional<sol::function> onModifiersChanged;
+    std::optional<sol::function> getAllStats;
     std::optional<sol::function> canApplyToUnit;
     std::optional<sol::function> canApplyToUnitType;
     std::optional<sol::function> canApplyAsLowerSpell;
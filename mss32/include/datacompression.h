@@ -0,0 +1,47 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATACOMPRESSION_H
+#define DATACOMPRESSION_H
+
+#include <cstdint>
+#include <vector>
+
+namespace hooks {
+
+/**
+ * Compresses data using simple LZ77 block format.
+ * @returns false if compressed data is not smaller than the source.
+ */
+bool compressData(const unsigned char* data,
+                  std::uint32_t size,
+                  std::vector<unsigned char>& result);
+
+/**
+ * Decompresses data compressed with compressData.
+ * @returns false if compressed data is malformed or does not match expected size.
+ */
+bool decompressData(const unsigned char* data,
+                    std::uint32_t size,
+                    unsigned char* result,
+                    std::uint32_t resultSize);
+
+} // namespace hooks
+
+#endif // DATACOMPRESSION_H
@@ -46,6 +46,9 @@ public:
     bool value(int& result, std::uint32_t columnIndex) const;
     bool value(int& result, const std::string& columnName) const;
     bool value(int& result, const DbfColumn& column) const;
+    bool value(double& result, std::uint32_t columnIndex) const;
+    bool value(double& result, const std::string& columnName) const;
+    bool value(double& result, const DbfColumn& column) const;
 
     // Logical fields access
     bool value(bool& result, std::uint32_t columnIndex) const;
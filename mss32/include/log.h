@@ -30,6 +30,19 @@ void logDebug(const std::string& logFile, const std::string& message);
 /** Prints message to the file. */
 void logError(const std::string& logFile, const std::string& message);
 
+/**
+ * Starts background thread that writes log messages to files.
+ * Messages logged earlier are kept until the thread starts.
+ * Must not be called from DllMain, threads should not be started under the loader lock.
+ */
+void startLogger();
+
+/**
+ * Writes pending log messages to files in a calling thread.
+ * Messages are written by a background thread, use this on exit or crash.
+ */
+void flushLogs();
+
 } // namespace hooks
 
 #endif // LOG_H
@@ -0,0 +1,48 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUASTATES_H
+#define LUASTATES_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+
+namespace hooks {
+
+/**
+ * Maximum number of lua instances.
+ * Each thread that runs scripts uses its own instance while it holds a lease.
+ */
+constexpr std::size_t maxLuaStates = 8;
+
+/**
+ * Objects bound to lua instances, such as script functions or environments.
+ * Indexed by getLuaIndex(), each object must be created in a thread that uses the instance.
+ */
+template <typename T>
+using LuaStateObjects = std::array<T*, maxLuaStates>;
+
+/** Objects bound to lua instances that are owned and destroyed by their holder. */
+template <typename T>
+using OwnedLuaStateObjects = std::array<std::unique_ptr<T>, maxLuaStates>;
+
+} // namespace hooks
+
+#endif // LUASTATES_H
@@ -23,6 +23,7 @@
 #include "lobbycallbacks.h"
 #include "menubase.h"
 #include "uievent.h"
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
@@ -47,6 +48,9 @@ struct CMenuCustomLobby : public game::CMenuBase
 {
     game::UiEvent roomsListEvent;
     std::vector<RoomInfo> rooms; // cached data
+    /** Time of the last rooms search request that is not answered yet. */
+    std::chrono::steady_clock::time_point roomsSearchTime;
+    bool roomsSearchPending;
     std::unique_ptr<UiUpdateCallbacks> uiCallbacks;
     std::unique_ptr<RoomsListCallbacks> roomsCallbacks;
     game::NetMsgEntryData** netMsgEntryData;
@@ -62,8 +66,15 @@ void customLobbyProcessLogin(CMenuCustomLobby* menu, const char* accountName);
 
 void customLobbyProcessLogout(CMenuCustomLobby* menu);
 
+/**
+ * Updates cached rooms with search results.
+ * Known rooms are updated in place and keep their order, new rooms are added to the end.
+ */
 void customLobbySetRoomsInfo(CMenuCustomLobby* menu, std::vector<RoomInfo>&& rooms);
 
+/** Handles failed rooms search request. */
+void customLobbyProcessRoomsSearchError(CMenuCustomLobby* menu, const char* message);
+
 void customLobbyProcessJoinError(CMenuCustomLobby* menu, const char* message);
 
 bool customLobbyCheckRoomPassword(CMenuCustomLobby* menu, const char* password);
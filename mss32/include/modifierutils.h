@@ -24,7 +24,6 @@
 #include "idlist.h"
 #include "immunecat.h"
 #include "midgardid.h"
-#include <set>
 
 namespace game {
 struct IMidgardObjectMap;
@@ -98,7 +97,7 @@ bool canApplyAnyModifier(game::IAttack* attack,
                          game::BattleMsgData* battleMsgData,
                          game::CMidgardID* targetUnitId);
 
-void resetModifiedUnitsInfo(game::UnitInfo* unitInfo);
+void resetModifiedUnitsInfo(game::BattleMsgData* battleMsgData, game::UnitInfo* unitInfo);
 
 bool addModifiedUnitInfo(const game::CMidgardID* unitId,
                          game::BattleMsgData* battleMsgData,
@@ -119,10 +118,29 @@ void removeModifiers(game::BattleMsgData* battleMsgData,
                      game::UnitInfo* unitInfo,
                      const game::CMidgardID* modifiedUnitId);
 
-std::set<game::CMidgardID> getModifiedUnitIds(game::UnitInfo* unitInfo);
+/** Unique ids collected from modified units, avoids allocations on each battle turn. */
+struct ModifiedUnitIds
+{
+    const game::CMidgardID* begin() const
+    {
+        return ids;
+    }
 
-std::set<game::CMidgardID> getUnitModifierIds(game::UnitInfo* unitInfo,
-                                              const game::CMidgardID* modifiedUnitId);
+    const game::CMidgardID* end() const
+    {
+        return ids + count;
+    }
+
+    void addUnique(const game::CMidgardID& id);
+
+    game::CMidgardID ids[game::ModifiedUnitCountPatched];
+    std::size_t count{};
+};
+
+ModifiedUnitIds getModifiedUnitIds(game::UnitInfo* unitInfo);
+
+ModifiedUnitIds getUnitModifierIds(game::UnitInfo* unitInfo,
+                                   const game::CMidgardID* modifiedUnitId);
 
 game::IAttack* wrapAltAttack(const game::IUsUnit* unit, game::IAttack* attack);
 
@@ -0,0 +1,60 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NETCOMPRESSION_H
+#define NETCOMPRESSION_H
+
+#include <cstdint>
+#include <vector>
+
+namespace game {
+struct NetMessageHeader;
+}
+
+namespace SLNet {
+class RakPeerInterface;
+struct AddressOrGUID;
+struct Packet;
+} // namespace SLNet
+
+namespace hooks {
+
+/** Game messages shorter than this are always sent as is. */
+static constexpr std::uint32_t netCompressionThreshold{1024};
+
+/**
+ * Sends game message to the target, compressing it if allowed and worth it.
+ * @returns SLNet Send() result.
+ */
+std::uint32_t sendGameMessage(SLNet::RakPeerInterface* peer,
+                              const game::NetMessageHeader* message,
+                              const SLNet::AddressOrGUID& target,
+                              bool broadcast,
+                              bool compress);
+
+/**
+ * Decompresses game message from packet with ID_PLAYER_COMPRESSED_MESSAGE type.
+ * @returns decompressed message stored in buffer or nullptr in case of error.
+ */
+const game::NetMessageHeader* decompressGameMessage(const SLNet::Packet* packet,
+                                                    std::vector<unsigned char>& buffer);
+
+} // namespace hooks
+
+#endif // NETCOMPRESSION_H
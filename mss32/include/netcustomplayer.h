@@ -21,6 +21,7 @@
 #define NETCUSTOMPLAYER_H
 
 #include "mqnetplayer.h"
+#include "netplayermessages.h"
 #include "networkpeer.h"
 #include <cstdint>
 #include <string>
@@ -34,6 +35,42 @@ namespace hooks {
 
 struct CNetCustomSession;
 
+/** Sends features supported by this version to the target. */
+void sendPlayerFeatures(SLNet::RakPeerInterface* peer, const SLNet::AddressOrGUID& target);
+
+/** Reads features from ID_PLAYER_FEATURES packet. */
+std::uint8_t readPlayerFeatures(const SLNet::Packet* packet);
+
+/**
+ * Remembers features of a remote player connected to local player.
+ * Players are registered with no features as soon as they connect,
+ * so older versions that never announce features disable them.
+ */
+void setRemotePlayerFeatures(const void* localPlayer, std::uint32_t netId, std::uint8_t features);
+
+/** Registers remote player with no features unless its features are already known. */
+void addRemotePlayer(const void* localPlayer, std::uint32_t netId);
+
+void removeRemotePlayer(const void* localPlayer, std::uint32_t netId);
+
+/** Forgets all remote players of local player. */
+void removeRemotePlayers(const void* localPlayer);
+
+/**
+ * Returns true if every remote player this process exchanges messages with supports features.
+ * Returns false when there are no remote players known.
+ * Used when message contents are serialized once for all recipients.
+ */
+bool remotePlayersSupport(std::uint8_t features);
+
+/**
+ * Starts connection to the player server at specified address.
+ * Connection is asynchronous: it completes with ID_CONNECTION_REQUEST_ACCEPTED
+ * or fails with ID_CONNECTION_ATTEMPT_FAILED when all connection attempts time out.
+ */
+SLNet::ConnectionAttemptResult connectToPlayerServer(SLNet::RakPeerInterface* peer,
+                                                     const SLNet::SystemAddress& address);
+
 struct CNetCustomPlayer : public game::IMqNetPlayer
 {
     // Ports for SLNet peer, should be on the same IP as lobby client
@@ -22,10 +22,12 @@
 
 #include "mqnetplayerclient.h"
 #include "netcustomplayer.h"
+#include "netmessagebatcher.h"
+#include "netmessagequeue.h"
 #include <NatPunchthroughClient.h>
-#include <list>
 #include <slikenet/types.h>
 #include <utility>
+#include <vector>
 
 namespace hooks {
 
@@ -68,15 +70,16 @@ struct CNetCustomPlayerClient : public game::IMqNetPlayerClient
 
     void setupPacketCallbacks();
 
-    using NetMessagePtr = std::unique_ptr<unsigned char[]>;
-    using IdMessagePair = std::pair<std::uint32_t, NetMessagePtr>;
-
-    std::list<IdMessagePair> messages;
+    NetMessageQueue messages;
+    std::vector<unsigned char> decompressedMessage;
     CNetCustomPlayer player;
     PlayerClientCallbacks callbacks;
+    NetMessageBatcher batcher;
     SLNet::NatPunchthroughClient natClient;
     SLNet::SystemAddress serverAddress;
     std::uint32_t serverId;
+    /** PlayerFeatures supported by the server. */
+    std::uint8_t serverFeatures{};
 };
 
 CNetCustomPlayerClient* createCustomPlayerClient(CNetCustomSession* session, const char* name);
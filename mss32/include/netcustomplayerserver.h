@@ -22,8 +22,11 @@
 
 #include "mqnetplayerserver.h"
 #include "netcustomplayer.h"
+#include "netmessagebatcher.h"
+#include "netmessagequeue.h"
 #include <NatPunchthroughClient.h>
-#include <list>
+#include <mutex>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -64,15 +67,29 @@ struct CNetCustomPlayerServer : public game::IMqNetPlayerServer
 
     bool notifyHostClientConnected();
 
+    void addClient(const SLNet::RakNetGUID& guid);
+    void removeClient(const SLNet::RakNetGUID& guid);
+    void setClientFeatures(const SLNet::RakNetGUID& guid, std::uint8_t features);
+    /** Returns PlayerFeatures supported by client, clientsMutex should be locked. */
+    std::uint8_t getClientFeatures(std::uint32_t netId) const;
+
     CNetCustomPlayer player;
     PlayerServerCallbacks callbacks;
     SLNet::NatPunchthroughClient natClient;
+    NetMessageBatcher batcher;
 
-    using NetMessagePtr = std::unique_ptr<unsigned char[]>;
-    using IdMessagePair = std::pair<std::uint32_t, NetMessagePtr>;
-
-    std::list<IdMessagePair> messages;
+    NetMessageQueue messages;
+    std::vector<unsigned char> decompressedMessage;
+    /** Guards clients, they are changed in ui thread and used by server thread. */
+    std::mutex clientsMutex;
+    /** Connected clients in order of connection, host client is the first one. */
     std::vector<SLNet::RakNetGUID> connectedIds;
+    /** Connected clients by their net ids. */
+    std::unordered_map<std::uint32_t, SLNet::RakNetGUID> clientsByNetId;
+    /** PlayerFeatures supported by clients, by their net ids. */
+    std::unordered_map<std::uint32_t, std::uint8_t> clientFeatures;
+    /** Lobby server is connected to player server for NAT punchthrough. */
+    SLNet::RakNetGUID lobbyServerGuid{SLNet::UNASSIGNED_RAKNET_GUID};
 };
 
 game::IMqNetPlayerServer* createCustomPlayerServer(CNetCustomSession* session,
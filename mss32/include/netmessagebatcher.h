@@ -0,0 +1,105 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NETMESSAGEBATCHER_H
+#define NETMESSAGEBATCHER_H
+
+#include "uievent.h"
+#include <cstdint>
+#include <mutex>
+#include <slikenet/types.h>
+#include <vector>
+
+namespace game {
+struct NetMessageHeader;
+}
+
+namespace SLNet {
+class RakPeerInterface;
+struct Packet;
+} // namespace SLNet
+
+namespace hooks {
+
+struct NetworkPeer;
+
+/**
+ * Coalesces small game messages sent to the same target during single iteration
+ * of the game message loop into ID_PLAYER_BATCHED_MESSAGES packets.
+ * Each target has its own pending batch, so messages sent to clients one by one are batched too.
+ * Pending batches are sent when one of them is full
+ * or when the game processes flush event posted with the first message of a batch.
+ * Message order is preserved for every recipient.
+ */
+class NetMessageBatcher
+{
+public:
+    NetMessageBatcher(NetworkPeer* netPeer);
+    ~NetMessageBatcher();
+
+    /**
+     * Sends game message to the target or adds it to the pending batch.
+     * @param features PlayerFeatures supported by the target.
+     * @returns false if SLNet rejected the message.
+     */
+    bool send(const game::NetMessageHeader* message,
+              const SLNet::AddressOrGUID& target,
+              bool broadcast,
+              std::uint8_t features);
+
+    /** Sends pending batches. */
+    void flush();
+
+    game::UiEvent flushEvent{};
+
+private:
+    struct Batch
+    {
+        std::vector<unsigned char> data;
+        std::uint32_t messages{};
+        SLNet::AddressOrGUID target;
+        bool broadcast{};
+    };
+
+    /** Sends pending batch, logs and returns false if SLNet rejected it. */
+    bool flushBatch(Batch& batch);
+    /** Sends pending batches in order they were created. */
+    bool flushBatches();
+
+    std::mutex mutex;
+    const NetworkPeer* netPeer;
+    SLNet::RakPeerInterface* peer;
+    /** Pending batches in order of their first messages. */
+    std::vector<Batch> batches;
+    std::uint32_t flushMessageId{};
+    bool flushPending{};
+};
+
+/**
+ * Reads next game message from ID_PLAYER_BATCHED_MESSAGES packet.
+ * @param[in,out] offset position of the message in the packet, advanced past it.
+ * Start reading with offset of 1 to skip packet id.
+ * @returns nullptr when there are no more messages or the packet is malformed.
+ */
+const game::NetMessageHeader* readBatchedMessage(const SLNet::Packet* packet,
+                                                 std::uint32_t& offset);
+
+} // namespace hooks
+
+#endif // NETMESSAGEBATCHER_H
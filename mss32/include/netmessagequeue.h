@@ -0,0 +1,109 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NETMESSAGEQUEUE_H
+#define NETMESSAGEQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace game {
+struct NetMessageHeader;
+}
+
+namespace hooks {
+
+/** Returns true if message length is within limits and fits in received packet. */
+bool isNetMessageLengthValid(const game::NetMessageHeader* message, std::uint32_t packetLength);
+
+/**
+ * Reads next game message from data of batched messages.
+ * @param[in,out] offset position of the message in data, advanced past it.
+ * @returns nullptr when there are no more messages or the data is malformed.
+ */
+const game::NetMessageHeader* readBatchedMessage(const unsigned char* data,
+                                                 std::uint32_t length,
+                                                 std::uint32_t& offset);
+
+/**
+ * Queue of received game messages between a single producer (network peer callbacks)
+ * and a single consumer (game calls to receiveMessage).
+ * Messages are copied into a preallocated ring buffer, no allocations are made per message.
+ * When ring buffer is full, messages are kept in a separate list until consumer catches up.
+ */
+class NetMessageQueue
+{
+public:
+    NetMessageQueue();
+
+    /** Copies message to the queue. Called by producer. */
+    void push(std::uint32_t idFrom, const game::NetMessageHeader* message);
+
+    /**
+     * Returns first message in the queue without removing it. Called by consumer.
+     * @param[out] pushTime optional, receives netTimestamp of the moment message was queued.
+     * @returns nullptr if queue is empty.
+     */
+    const game::NetMessageHeader* front(std::uint32_t& idFrom,
+                                        std::uint32_t* pushTime = nullptr);
+
+    /** Removes first message from the queue. Called by consumer. */
+    void pop();
+
+    std::uint32_t size() const;
+
+private:
+    struct Record
+    {
+        std::uint32_t idFrom;
+        std::uint32_t length;
+        std::uint32_t pushTime;
+        std::uint32_t reserved; /**< Pads record to its alignment. */
+    };
+
+    struct OverflowMessage
+    {
+        std::uint32_t idFrom;
+        std::uint32_t pushTime;
+        std::vector<unsigned char> data;
+    };
+
+    bool pushToRing(std::uint32_t idFrom,
+                    const game::NetMessageHeader* message,
+                    std::uint32_t pushTime);
+
+    std::unique_ptr<unsigned char[]> ring;
+    std::atomic<std::uint32_t> head{}; /**< Write position, changed by producer. */
+    std::atomic<std::uint32_t> tail{}; /**< Read position, changed by consumer. */
+    std::atomic<std::uint32_t> pushed{};
+    std::atomic<std::uint32_t> popped{};
+
+    std::mutex overflowMutex;
+    std::atomic<bool> overflowed{};
+    std::deque<OverflowMessage> overflow;
+    bool frontFromOverflow{};
+};
+
+} // namespace hooks
+
+#endif // NETMESSAGEQUEUE_H
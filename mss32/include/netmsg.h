@@ -21,45 +21,13 @@
 #define NETMSG_H
 
 #include "d2assert.h"
-#include <cstdint>
+#include "netmessageheader.h"
 
 namespace game {
 
 struct CNetMsgVftable;
 struct CMqStream;
 
-/**
- * Network messages common header part.
- * Each ingame message that is being sent or received over network starts with it.
- * CNetMsg fills and checks header in its serialize method.
- */
-struct NetMessageHeader
-{
-    /** Equals to netMessageNormalType for game specific messages. */
-    std::uint32_t messageType;
-    /** Length of message in bytes, including header. */
-    std::uint32_t length;
-    /**
-     * Raw name of CNetMsg or its derived class.
-     * Obtained as @code{.cpp}typeid(msg).raw_name();@endcode which is Windows specific.
-     * @see https://docs.microsoft.com/en-us/cpp/cpp/type-info-class for additional info.
-     */
-    char messageClassName[36];
-};
-
-assert_size(NetMessageHeader, 44);
-
-/** Game specific messages treated as normal in DirectPlay terms. */
-static constexpr std::uint32_t netMessageNormalType{0xffff};
-
-/** Maximum allowed net message length in bytes. */
-static constexpr std::uint32_t netMessageMaxLength{0x80000};
-
-/** Used for sending messages between players in single, DPlay and Lobby sessions. */
-static constexpr std::uint32_t broadcastNetPlayerId{0};
-static constexpr std::uint32_t serverNetPlayerId{1};
-static constexpr std::uint32_t singleNetPlayerId{0xffffff};
-
 template <typename T = CNetMsgVftable>
 struct CNetMsgT
 {
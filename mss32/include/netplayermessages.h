@@ -0,0 +1,59 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NETPLAYERMESSAGES_H
+#define NETPLAYERMESSAGES_H
+
+#include <MessageIdentifiers.h>
+#include <cstdint>
+
+namespace hooks {
+
+/** Packets exchanged between player client and player server besides game messages. */
+enum PlayerMessages
+{
+    /**
+     * Announces transport features supported by the sender, followed by PlayerFeatures byte.
+     * Client sends it to the server along with game version request, server responds with its own.
+     * Older versions ignore unknown packets, so features are never used with them.
+     */
+    ID_PLAYER_FEATURES = ID_USER_PACKET_ENUM + 16,
+    /** Game message compressed with compressData, followed by its original length. */
+    ID_PLAYER_COMPRESSED_MESSAGE,
+    /** Several game messages sent one after another, see NetMessageBatcher. */
+    ID_PLAYER_BATCHED_MESSAGES,
+};
+
+/**
+ * Size limit of ID_PLAYER_BATCHED_MESSAGES packet.
+ * Batch fits into a single datagram and is smaller than compression threshold.
+ */
+static constexpr std::uint32_t netBatchMaxLength{1024};
+
+enum PlayerFeatures : std::uint8_t
+{
+    Compression = 1,
+    Batching = 2,
+    /** Battle messages carry modified units in compact format, see netmsgutils. */
+    CompactModifiedUnits = 4,
+};
+
+} // namespace hooks
+
+#endif // NETPLAYERMESSAGES_H
@@ -0,0 +1,66 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NETSTATISTICS_H
+#define NETSTATISTICS_H
+
+#include <cstdint>
+
+namespace game {
+struct NetMessageHeader;
+}
+
+namespace hooks {
+
+/**
+ * Returns current time in microseconds from an arbitrary point.
+ * Value wraps around, use only to measure short intervals.
+ */
+std::uint32_t netTimestamp();
+
+/**
+ * Accounts game message sent to other players.
+ * @param wireLength size of the packet actually sent, after compression.
+ */
+void netStatisticsMessageSent(const game::NetMessageHeader* message, std::uint32_t wireLength);
+
+/**
+ * Accounts game message received from network.
+ * @param latency estimated transport latency in microseconds.
+ */
+void netStatisticsMessageReceived(const game::NetMessageHeader* message,
+                                  std::uint32_t wireLength,
+                                  std::uint32_t latency);
+
+/**
+ * Accounts game message taken by the game from receive queue.
+ * @param queueWait time in microseconds message spent in the queue.
+ */
+void netStatisticsMessageDequeued(const game::NetMessageHeader* message,
+                                  std::uint32_t queueWait);
+
+/**
+ * Writes accumulated statistics to file.
+ * Called when custom net service is destroyed to keep the last values.
+ */
+void netStatisticsDump();
+
+} // namespace hooks
+
+#endif // NETSTATISTICS_H
@@ -23,6 +23,8 @@
 #include "uievent.h"
 #include <MessageIdentifiers.h>
 #include <RakPeerInterface.h>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
@@ -39,7 +41,12 @@ public:
 };
 
 /**
- * Wraps SLikeNet peer interface and game timer event for network packets processing.
+ * Wraps SLikeNet peer interface and game ui events for network packets processing.
+ * Packets are processed as soon as peer receives datagrams:
+ * socket thread posts wakeup message to the game window and packets are handled in ui thread.
+ * Datagram can reach ui thread before peer update thread turns it into a packet,
+ * in this case packets are polled for a short time after the wakeup.
+ * Timer event processes packets periodically in case wakeup message was missed.
  * Allows users to subscribe to peer packet events.
  */
 struct NetworkPeer
@@ -61,10 +68,24 @@ struct NetworkPeer
     void addCallback(NetworkPeerCallbacks* callback);
     void removeCallback(NetworkPeerCallbacks* callback);
 
+    /**
+     * Posts message registered with createMessageEvent to the game window.
+     * Can be called from any thread.
+     * @returns false if the message was not posted.
+     */
+    bool postMessage(std::uint32_t messageId, std::uintptr_t wParam = 0) const;
+
     game::UiEvent packetEvent{};
+    game::UiEvent wakeupEvent{};
+    game::UiEvent wakeupRetryEvent{};
     std::vector<NetworkPeerCallbacks*> callbacks;
     std::vector<NetworkPeerCallbacks*> removeCallbacks;
     PeerPtr peer;
+    void* gameWindow{};
+    std::uint32_t wakeupMessageId{};
+    std::uint32_t wakeupRetries{};
+    bool wakeupRetryActive{};
+    std::atomic<bool> wakeupPending{};
 };
 
 } // namespace hooks
@@ -0,0 +1,77 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OCCUPANCYMASK_H
+#define OCCUPANCYMASK_H
+
+#include <cstddef>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace hooks {
+
+/** Returns index of the lowest set bit. Mask must not be zero. */
+inline unsigned long getLowestSetBit(std::uint64_t mask)
+{
+#ifdef _MSC_VER
+    // 64-bit bit scan is not available on x86
+    unsigned long index;
+    const auto low = static_cast<std::uint32_t>(mask);
+    if (low) {
+        _BitScanForward(&index, low);
+        return index;
+    }
+
+    _BitScanForward(&index, static_cast<std::uint32_t>(mask >> 32));
+    return index + 32;
+#else
+    return static_cast<unsigned long>(__builtin_ctzll(mask));
+#endif
+}
+
+/** Returns mask with bits set for each of slots count. */
+constexpr std::uint64_t getFullMask(std::size_t slotsCount)
+{
+    return slotsCount >= 64 ? ~std::uint64_t{} : (std::uint64_t{1} << slotsCount) - 1;
+}
+
+/**
+ * Returns index of the lowest free slot.
+ * @returns slotsCount if all slots are occupied.
+ */
+inline std::size_t findFreeSlot(std::uint64_t occupancy, std::size_t slotsCount)
+{
+    const auto free = ~occupancy & getFullMask(slotsCount);
+    return free ? getLowestSetBit(free) : slotsCount;
+}
+
+/** Calls function with index of each set bit, from the lowest to the highest one. */
+template <typename T>
+void forEachSetBit(std::uint64_t mask, T&& function)
+{
+    for (; mask; mask &= mask - 1) {
+        function(getLowestSetBit(mask));
+    }
+}
+
+} // namespace hooks
+
+#endif // OCCUPANCYMASK_H
@@ -0,0 +1,77 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCENVARIABLESINDEX_H
+#define SCENVARIABLESINDEX_H
+
+#include "midscenvariables.h"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace hooks {
+
+/**
+ * Search index of scenario variables by name and id.
+ * Game does not have functions for search variables by name and searches them by id in a tree.
+ * Variables list is created once per scenario, there are no additions or deletions of them
+ * during the game, so the index is built once and shared by scripts and event conditions.
+ */
+struct ScenarioVariablesIndex
+{
+    using Variables = std::vector<const game::ScenarioVariable*>;
+
+    /**
+     * Returns variable by name in uppercase, as game stores it, or nullptr if not found.
+     * If several variables have the same name, the last one is returned.
+     */
+    const game::ScenarioVariable* findByName(std::string_view name) const;
+    /** Returns all variables with specified name in uppercase. */
+    const Variables& findAllByName(std::string_view name) const;
+    /** Returns variable by its id or nullptr if not found. */
+    const game::ScenarioVariable* findById(int id) const;
+
+    const game::CMidScenVariables* scenVariables;
+    const void* head;
+    std::uint32_t length;
+    std::unordered_map<std::string_view, Variables> byName;
+    std::unordered_map<int, const game::ScenarioVariable*> byId;
+};
+
+using ScenarioVariablesIndexPtr = std::shared_ptr<const ScenarioVariablesIndex>;
+
+/**
+ * Returns index of specified scenario variables.
+ * Index is rebuilt only when different variables list is requested
+ * or after it was reset.
+ */
+ScenarioVariablesIndexPtr getScenarioVariablesIndex(const game::CMidScenVariables* scenVariables);
+
+/**
+ * Drops current index.
+ * Must be called when scenario is loaded or unloaded: memory of freed variables can be reused
+ * by the next scenario, so addresses alone can not tell that the index is stale.
+ */
+void resetScenarioVariablesIndex();
+
+} // namespace hooks
+
+#endif // SCENVARIABLESINDEX_H
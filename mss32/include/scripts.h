@@ -20,6 +20,7 @@
 #ifndef SCRIPTS_H
 #define SCRIPTS_H
 
+#include "luastates.h"
 #include <filesystem>
 #include <lua.hpp>
 #include <optional>
@@ -27,12 +28,61 @@
 
 namespace hooks {
 
+/**
+ * Returns lua instance of the calling thread with bound api.
+ * Instances are taken from the pool of maxLuaStates instances on first use.
+ * If all instances are in use, blocks until some other thread releases its instance.
+ */
+sol::state& getLua();
+
+/** Returns index of lua instance used by the calling thread, acquires the instance if needed. */
+std::size_t getLuaIndex();
+
+/**
+ * Returns lua instance of the calling thread back to the pool.
+ * Instance is not destroyed: objects created in it stay valid and are reused by the next thread.
+ * Does nothing while LuaLease scopes are active.
+ * Called automatically on thread exit.
+ */
+void releaseLua();
+
+/**
+ * Keeps lua instance of the calling thread while scripts run, returns it to the pool
+ * when the outermost lease ends. Lua objects of the instance that are not bound
+ * by LuaStateObjects must be destroyed before the lease, so create it first.
+ */
+class LuaLease
+{
+public:
+    LuaLease();
+    ~LuaLease();
+
+    LuaLease(const LuaLease&) = delete;
+    LuaLease& operator=(const LuaLease&) = delete;
+};
+
+/** Script function together with the environment it executes in. */
+struct ScriptFunction
+{
+    std::optional<sol::environment> environment;
+    std::optional<sol::function> function;
+};
+
 /** Returns lua environment with bound api and specified source loaded and executed. */
 sol::environment executeScript(const std::string& source,
                                sol::protected_function_result& result,
                                bool bindScenario = false);
 
-/** Returns lua environment with bound api and specified file loaded and executed. */
+/**
+ * Makes executeScriptFile check script files for changes on their next use.
+ * Called when scenario is loaded.
+ */
+void reloadScriptFiles();
+
+/**
+ * Returns lua environment with bound api and specified file loaded and executed.
+ * Script files are read and compiled once, see reloadScriptFiles().
+ */
 std::optional<sol::environment> executeScriptFile(const std::filesystem::path& path,
                                                   bool alwaysExists = false,
                                                   bool bindScenario = false);
@@ -72,6 +122,18 @@ std::optional<sol::function> getScriptFunction(const std::filesystem::path& path
  * @param[in] name function name in lua script.
  * @param[in] alwaysExists true to show error message if the function does not exist.
  */
+/**
+ * Returns function with specified name from script file loaded in lua instance
+ * of the calling thread. Script is loaded once per lua instance.
+ * @param[in] functions loaded functions of each lua instance.
+ */
+const std::optional<sol::function>& getScriptFunction(
+    OwnedLuaStateObjects<ScriptFunction>& functions,
+    const std::filesystem::path& path,
+    const char* name,
+    bool alwaysExists = false,
+    bool bindScenario = false);
+
 std::optional<sol::protected_function> getProtectedScriptFunction(
     const sol::environment& environment,
     const char* name,
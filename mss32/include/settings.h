@@ -161,6 +161,8 @@ struct Settings
     {
         std::uint32_t sendObjectsChangesTreshold{0};
         bool logSinglePlayerMessages{false};
+        /** Collect per message class network statistics into 'netStatistics.csv'. */
+        bool netStatistics{false};
     } debug;
 
     struct Engine
@@ -21,6 +21,7 @@
 #include "attack.h"
 #include "attackmodified.h"
 #include "customattacks.h"
+#include "customattackutils.h"
 #include "custommodifier.h"
 #include "dynamiccast.h"
 #include "globaldata.h"
@@ -200,11 +201,8 @@ bool isMeleeAttack(game::AttackReachId id)
     if (id == reaches.adjacent->id) {
         return true;
     } else if (id != reaches.all->id && id != reaches.any->id) {
-        for (auto& custom : getCustomAttacks().reaches) {
-            if (id == custom.reach.id) {
-                return custom.melee;
-            }
-        }
+        auto custom = findCustomAttackReach(id);
+        return custom && custom->melee;
     }
 
     return false;
@@ -220,15 +218,10 @@ int getAttackMaxTargets(const game::AttackReachId id)
         return 6;
     } else if (id == reaches.any->id || id == reaches.adjacent->id) {
         return 1;
-    } else {
-        for (const auto& custom : getCustomAttacks().reaches) {
-            if (id == custom.reach.id) {
-                return custom.maxTargets;
-            }
-        }
     }
 
-    return 0;
+    auto custom = findCustomAttackReach(id);
+    return custom ? custom->maxTargets : 0;
 }
 
 } // namespace hooks
@@ -20,21 +20,55 @@
 #include "battlemsgdatahooks.h"
 #include "batattack.h"
 #include "customattacks.h"
+#include "customattackutils.h"
 #include "gameutils.h"
 #include "intset.h"
 #include "log.h"
 #include "midstack.h"
 #include "modifierutils.h"
 #include "originalfunctions.h"
+#include "settings.h"
 #include "unitutils.h"
 #include <atomic>
+#include <cstddef>
+#include <cstring>
 #include <fmt/format.h>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <vector>
 
 namespace hooks {
 
+/**
+ * Allocates modified units arrays of all BattleMsgData units as a single block.
+ * Each array is preceded by its occupancy mask.
+ * Blocks are reference counted and shared between battle data copies until one of them
+ * changes modified units, since AI copies battle data many times per decision
+ * and rarely touches bestowed wards.
+ * Freed blocks are kept for reuse.
+ */
 class ModifiedUnitsPatchedFactory
 {
 public:
+    static constexpr std::size_t unitsInfoCount{
+        std::extent_v<decltype(game::BattleMsgData::unitsInfo)>};
+
+    /** Modified units of a single unit. */
+    struct Slot
+    {
+        std::uint64_t occupancy;
+        game::ModifiedUnitInfo units[game::ModifiedUnitCountPatched];
+    };
+
+    static_assert(game::ModifiedUnitCountPatched <= 64,
+                  "Occupancy mask should have a bit for each modified unit");
+
+    static Slot* getSlot(game::ModifiedUnitInfo* units)
+    {
+        return reinterpret_cast<Slot*>(reinterpret_cast<char*>(units) - offsetof(Slot, units));
+    }
+
     ModifiedUnitsPatchedFactory()
         : count(0)
     { }
@@ -44,27 +78,173 @@ public:
         if (count != 0) {
             logError("mssProxyError.log",
                      fmt::format("{:d} instances of ModifiedUnitsPatched remained on finalization",
-                                 count));
+                                 count * unitsInfoCount));
+        }
+
+        for (auto block : freeBlocks) {
+            delete block;
+        }
+    }
+
+    void create(game::BattleMsgData* battleMsgData)
+    {
+        auto block = allocate();
+        for (std::size_t i = 0; i < unitsInfoCount; ++i) {
+            auto& slot = block->slots[i];
+            slot.occupancy = 0;
+            for (auto& info : slot.units) {
+                info.unitId = game::invalidId;
+                info.modifierId = game::invalidId;
+            }
+
+            battleMsgData->unitsInfo[i].modifiedUnits.patched = slot.units;
+        }
+    }
+
+    /** Shares arrays of source battle data, arrays order of the source is preserved. */
+    void share(game::BattleMsgData* battleMsgData, const game::BattleMsgData* src)
+    {
+        getBlock(src)->references++;
+
+        for (std::size_t i = 0; i < unitsInfoCount; ++i) {
+            battleMsgData->unitsInfo[i].modifiedUnits.patched = src->unitsInfo[i]
+                                                                     .modifiedUnits.patched;
+        }
+    }
+
+    void makeUnique(game::BattleMsgData* battleMsgData)
+    {
+        auto block = getBlock(battleMsgData);
+        if (!block || block->references == 1) {
+            return;
+        }
+
+        auto unique = allocate();
+        std::memcpy(unique->slots, block->slots, sizeof(block->slots));
+
+        for (auto& unitInfo : battleMsgData->unitsInfo) {
+            auto& units = unitInfo.modifiedUnits.patched;
+            const auto offset = reinterpret_cast<char*>(units) - reinterpret_cast<char*>(block);
+            units = reinterpret_cast<game::ModifiedUnitInfo*>(reinterpret_cast<char*>(unique)
+                                                              + offset);
+        }
+
+        release(block);
+    }
+
+    void destroy(game::BattleMsgData* battleMsgData)
+    {
+        auto block = getBlock(battleMsgData);
+        if (!block) {
+            return;
+        }
+
+        for (auto& unitInfo : battleMsgData->unitsInfo) {
+            unitInfo.modifiedUnits.patched = nullptr;
+        }
+
+        release(block);
+    }
+
+private:
+    struct Block
+    {
+        std::atomic<std::uint32_t> references;
+        Slot slots[unitsInfoCount];
+    };
+
+    /** Limits memory kept for reuse, 64 blocks take about 0.5 MB. */
+    static constexpr std::size_t maxFreeBlocks{64};
+
+    static Block* getBlock(const game::BattleMsgData* battleMsgData)
+    {
+        // Arrays are moved between units when unit info is removed,
+        // but always stay within the same block. Block starts with the lowest one
+        game::ModifiedUnitInfo* first{};
+        for (const auto& unitInfo : battleMsgData->unitsInfo) {
+            auto units = unitInfo.modifiedUnits.patched;
+            if (!first || std::less<>()(units, first)) {
+                first = units;
+            }
         }
+
+        if (!first) {
+            return nullptr;
+        }
+
+        return reinterpret_cast<Block*>(reinterpret_cast<char*>(getSlot(first))
+                                        - offsetof(Block, slots));
     }
 
-    game::ModifiedUnitInfo* create()
+    Block* allocate()
     {
+        Block* block{};
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!freeBlocks.empty()) {
+                block = freeBlocks.back();
+                freeBlocks.pop_back();
+            }
+        }
+
+        if (!block) {
+            block = new Block;
+        }
+
+        block->references = 1;
         count++;
-        return new game::ModifiedUnitInfo[game::ModifiedUnitCountPatched];
+        return block;
     }
 
-    void destroy(game::ModifiedUnitInfo* value)
+    void release(Block* block)
     {
+        if (--block->references != 0) {
+            return;
+        }
+
         count--;
-        delete[] value;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (freeBlocks.size() < maxFreeBlocks) {
+            freeBlocks.push_back(block);
+        } else {
+            delete block;
+        }
     }
 
-private:
     std::atomic<int> count;
+    std::mutex mutex;
+    std::vector<Block*> freeBlocks;
 } modifiedUnitsPatchedFactory;
 
-void resetUnitInfo(game::UnitInfo* unitInfo)
+void makeModifiedUnitsUnique(game::BattleMsgData* battleMsgData)
+{
+    if (userSettings().unrestrictedBestowWards) {
+        modifiedUnitsPatchedFactory.makeUnique(battleMsgData);
+    }
+}
+
+std::uint64_t& getModifiedUnitsOccupancy(game::UnitInfo* unitInfo)
+{
+    return ModifiedUnitsPatchedFactory::getSlot(unitInfo->modifiedUnits.patched)->occupancy;
+}
+
+void updateModifiedUnitsOccupancy(game::UnitInfo* unitInfo)
+{
+    using namespace game;
+
+    std::uint64_t occupancy{};
+    const auto units = unitInfo->modifiedUnits.patched;
+    for (std::size_t i = 0; i < ModifiedUnitCountPatched; ++i) {
+        if (units[i].unitId != invalidId) {
+            occupancy |= std::uint64_t{1} << i;
+        }
+    }
+
+    getModifiedUnitsOccupancy(unitInfo) = occupancy;
+}
+
+void resetUnitInfo(game::BattleMsgData* battleMsgData, game::UnitInfo* unitInfo)
 {
     using namespace game;
 
@@ -74,7 +254,7 @@ void resetUnitInfo(game::UnitInfo* unitInfo)
     unitInfo->unitId1 = invalidId;
 
     unitInfo->modifiedUnits = modifiedUnits;
-    resetModifiedUnitsInfo(unitInfo);
+    resetModifiedUnitsInfo(battleMsgData, unitInfo);
 
     for (auto& modifierId : unitInfo->modifierIds) {
         modifierId = invalidId;
@@ -89,10 +269,9 @@ game::BattleMsgData* __fastcall battleMsgDataCtorHooked(game::BattleMsgData* thi
 
     for (auto& unitInfo : thisptr->unitsInfo) {
         memset(&unitInfo.modifiedUnits, 0, sizeof(ModifiedUnitsPatched));
-        unitInfo.modifiedUnits.patched = modifiedUnitsPatchedFactory.create();
-        resetModifiedUnitsInfo(&unitInfo);
     }
 
+    modifiedUnitsPatchedFactory.create(thisptr);
     return thisptr;
 }
 
@@ -120,19 +299,11 @@ game::BattleMsgData* __fastcall battleMsgDataCopyAssignHooked(game::BattleMsgDat
     if (thisptr == src)
         return thisptr;
 
-    const size_t count = std::size(thisptr->unitsInfo);
-    std::vector<ModifiedUnitInfo*> prev(count);
-    for (size_t i = 0; i < count; i++) {
-        prev[i] = thisptr->unitsInfo[i].modifiedUnits.patched;
-    }
+    modifiedUnitsPatchedFactory.destroy(thisptr);
 
     *thisptr = *src;
-
-    for (size_t i = 0; i < count; i++) {
-        memcpy(prev[i], src->unitsInfo[i].modifiedUnits.patched,
-               sizeof(ModifiedUnitInfo) * ModifiedUnitCountPatched);
-        thisptr->unitsInfo[i].modifiedUnits.patched = prev[i];
-    }
+    modifiedUnitsPatchedFactory.share(thisptr, src);
+    increaseBattleVersion();
 
     return thisptr;
 }
@@ -144,26 +315,15 @@ game::BattleMsgData* __fastcall battleMsgDataCopyHooked(game::BattleMsgData* thi
     using namespace game;
 
     *thisptr = *src;
-
-    const size_t count = std::size(thisptr->unitsInfo);
-    for (size_t i = 0; i < count; i++) {
-        auto modifiedUnits = modifiedUnitsPatchedFactory.create();
-        memcpy(modifiedUnits, src->unitsInfo[i].modifiedUnits.patched,
-               sizeof(ModifiedUnitInfo) * ModifiedUnitCountPatched);
-        thisptr->unitsInfo[i].modifiedUnits.patched = modifiedUnits;
-    }
+    modifiedUnitsPatchedFactory.share(thisptr, src);
+    increaseBattleVersion();
 
     return thisptr;
 }
 
 void __fastcall battleMsgDataDtorHooked(game::BattleMsgData* thisptr, int /*%edx*/)
 {
-    using namespace game;
-
-    for (auto& unitInfo : thisptr->unitsInfo) {
-        modifiedUnitsPatchedFactory.destroy(unitInfo.modifiedUnits.patched);
-        unitInfo.modifiedUnits.patched = nullptr;
-    }
+    modifiedUnitsPatchedFactory.destroy(thisptr);
 }
 
 void __fastcall removeUnitInfoHooked(game::BattleMsgData* thisptr,
@@ -191,11 +351,13 @@ void __fastcall removeUnitInfoHooked(game::BattleMsgData* thisptr,
     if (index < count) {
         auto lastInfo = &thisptr->unitsInfo[count - 1];
         lastInfo->modifiedUnits = modifiedUnits;
-        resetUnitInfo(lastInfo);
+        resetUnitInfo(thisptr, lastInfo);
     }
 
     while (battle.decreaseUnitAttacks(thisptr, unitId))
         ;
+
+    increaseBattleVersion();
 }
 
 void updateDefendBattleAction(const game::UnitInfo* unitInfo,
@@ -383,6 +545,7 @@ void __fastcall beforeBattleRoundHooked(game::BattleMsgData* thisptr, int /*%edx
     using namespace game;
 
     getOriginalFunctions().beforeBattleRound(thisptr);
+    increaseBattleVersion();
 
     // Fix free transform-self to properly reset if the same unit has consequent turns in consequent
     // battles
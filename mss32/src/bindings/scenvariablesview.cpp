@@ -28,17 +28,8 @@
 namespace bindings {
 
 ScenVariablesView::ScenVariablesView(const game::CMidScenVariables* scenVariables)
-    : scenVariables(scenVariables)
-{
-    // Game does not have functions for search variables by name,
-    // but accessing them using it is convenient for scripts.
-    // Cache scenario variables for our own fast search by name.
-    // This is safe because variables list is created once
-    // and there are no additions or deletions of them during the game.
-    for (const auto& variable : scenVariables->variables) {
-        variables[variable.second.name] = &variable;
-    }
-}
+    : index(hooks::getScenarioVariablesIndex(scenVariables))
+{ }
 
 void ScenVariablesView::bind(sol::state& lua)
 {
@@ -49,16 +40,24 @@ void ScenVariablesView::bind(sol::state& lua)
 std::optional<ScenarioVariableView> ScenVariablesView::getScenarioVariable(
     const std::string& name) const
 {
-    std::string ingameName{name};
-    // Game stores variable names in uppercase
-    std::transform(ingameName.begin(), ingameName.end(), ingameName.begin(), toupper);
-
-    const auto it = variables.find(ingameName);
-    if (it == variables.end()) {
-        return std::nullopt;
+    auto variable = index->findByName(name);
+    if (!variable) {
+        // Game stores variable names in uppercase,
+        // convert only names that were not found as is
+        std::string ingameName{name};
+        std::transform(ingameName.begin(), ingameName.end(), ingameName.begin(), toupper);
+
+        if (ingameName == name) {
+            return std::nullopt;
+        }
+
+        variable = index->findByName(ingameName);
+        if (!variable) {
+            return std::nullopt;
+        }
     }
 
-    return ScenarioVariableView{it->second};
+    return ScenarioVariableView{variable};
 }
 
 } // namespace bindings
@@ -63,9 +63,13 @@ game::LAttackClassTable* __fastcall attackClassTableCtorHooked(game::LAttackClas
     static const char dbfFileName[] = "LAttC.dbf";
     static const char customCategoryName[] = "L_CUSTOM";
 
+    // Global data is loaded by game and editor after DllMain returns, it is safe to start here
+    startLogger();
     logDebug("newAttackType.log", "LAttackClassTable c-tor hook started");
 
     const auto dbfFilePath{std::filesystem::path(globalsFolderPath) / dbfFileName};
+    fillAttackClassAiRatings(dbfFilePath);
+
     bool customAttackExists = utils::dbValueExists(dbfFilePath, "TEXT", customCategoryName);
     if (customAttackExists)
         logDebug("newAttackType.log", "Found custom attack category");
@@ -187,6 +191,7 @@ game::LAttackReachTable* __fastcall attackReachTableCtorHooked(game::LAttackReac
     }
 
     table.initDone(thisptr);
+    fillCustomAttackReachesById();
     logDebug("customAttacks.log", "LAttackReachTable c-tor hook finished");
     return thisptr;
 }
@@ -404,6 +409,20 @@ double __stdcall getSoldierImmunityAiRatingHooked(const game::IUsSoldier* soldie
 {
     using namespace game;
 
+    const auto& rtti = RttiApi::rtti();
+    const auto dynamicCast = RttiApi::get().dynamicCast;
+
+    // Unit implementations without modifiers never change their immunities
+    auto unit = (IUsUnit*)dynamicCast(soldier, 0, rtti.IUsSoldierType, rtti.IUsUnitType, 0);
+    const bool cacheable = unit && getUnitImpl(unit) == unit;
+
+    static thread_local std::map<CMidgardID, double> ratings;
+    if (cacheable) {
+        auto it = ratings.find(unit->id);
+        if (it != ratings.end())
+            return it->second;
+    }
+
     double result = getOriginalFunctions().getSoldierImmunityAiRating(soldier);
 
     const auto& immunities = ImmuneCategories::get();
@@ -413,6 +432,9 @@ double __stdcall getSoldierImmunityAiRatingHooked(const game::IUsSoldier* soldie
             result += custom.immunityAiRating;
     }
 
+    if (cacheable)
+        ratings[unit->id] = result;
+
     return result;
 }
 
@@ -421,49 +443,22 @@ double __stdcall getAttackClassAiRatingHooked(const game::IUsSoldier* soldier, b
     using namespace game;
 
     const auto& classes = AttackClassCategories::get();
-    const auto& reaches = AttackReachCategories::get();
 
     auto attack = soldier->vftable->getAttackById(soldier);
     auto attackClass = attack->vftable->getAttackClass(attack);
-    if (attackClass->id == classes.paralyze->id || attackClass->id == classes.petrify->id) {
-        return 30.0;
-    } else if (attackClass->id == classes.damage->id || attackClass->id == classes.heal->id) {
-        return 1.0;
-    } else if (attackClass->id == classes.drain->id) {
-        return 1.5;
-    } else if (attackClass->id == classes.fear->id) {
-        return 30.0;
-    } else if (attackClass->id == classes.boostDamage->id
-               || attackClass->id == classes.bestowWards->id) {
-        return 40.0;
-    } else if (attackClass->id == classes.shatter->id) {
-        return 30.0;
-    } else if (attackClass->id == classes.lowerDamage->id
-               || attackClass->id == classes.lowerInitiative->id) {
-        return 40.0;
-    } else if (attackClass->id == classes.drainOverflow->id) {
-        return 2.0;
-    } else if (attackClass->id == classes.summon->id) {
-        return 200.0;
-    } else if (attackClass->id == classes.drainLevel->id) {
-        return 100.0;
-    } else if (attackClass->id == classes.giveAttack->id) {
-        return 50.0;
-    } else if (attackClass->id == classes.doppelganger->id) {
-        return a2 ? 100.0 : 200.0;
-    } else if (attackClass->id == classes.transformSelf->id) {
-        return 100.0;
+
+    const auto& ratings = getCustomAttacks().attackClassAiRatings;
+    const auto index = static_cast<std::size_t>(attackClass->id);
+    const double rating = index < ratings.size() ? ratings[index] : 1.0;
+
+    if (attackClass->id == classes.doppelganger->id) {
+        return a2 ? rating / 2 : rating;
     } else if (attackClass->id == classes.transformOther->id) {
         auto attackReach = attack->vftable->getAttackReach(attack);
-        for (const auto& custom : getCustomAttacks().reaches) {
-            if (attackReach->id == custom.reach.id) {
-                return 60.0 + 8.0 * (custom.maxTargets - 1);
-            }
-        }
-        return attackReach->id == reaches.all->id ? 100.0 : 60.0;
+        return rating + 8.0 * (getAttackMaxTargets(attackReach->id) - 1);
     }
 
-    return 1.0;
+    return rating;
 }
 
 double __stdcall getAttackReachAiRatingHooked(const game::IUsSoldier* soldier, int targetCount)
@@ -480,16 +475,15 @@ double __stdcall getAttackReachAiRatingHooked(const game::IUsSoldier* soldier, i
         return 1.0 + 0.4 * targetFactor;
     } else if (attackReach->id == reaches.any->id) {
         return 1.5;
-    } else if (attackReach->id != reaches.adjacent->id) {
-        for (const auto& custom : getCustomAttacks().reaches) {
-            if (attackReach->id == custom.reach.id) {
-                int count = std::min(targetCount, (int)custom.maxTargets);
-                if (count == 1 && !custom.melee)
-                    return 1.5;
-                else
-                    return 1.0 + 0.4 * (computeTotalDamageRatio(attack, count) - 1);
-            }
-        }
+    }
+
+    auto custom = findCustomAttackReach(attackReach->id);
+    if (custom) {
+        int count = std::min(targetCount, (int)custom->maxTargets);
+        if (count == 1 && !custom->melee)
+            return 1.5;
+        else
+            return 1.0 + 0.4 * (computeTotalDamageRatio(attack, count) - 1);
     }
 
     return 1.0;
@@ -551,6 +545,7 @@ void __stdcall addUnitToBattleMsgDataHooked(const game::IMidgardObjectMap* objec
 
             getOriginalFunctions().addUnitToBattleMsgData(objectMap, group, unitId, attackerFlags,
                                                           battleMsgData);
+            increaseBattleVersion();
             return;
         }
     }
@@ -600,7 +595,7 @@ bool __stdcall getTargetsToAttackForAllOrCustomReach(game::IdList* value,
                 CMidgardID unitGroupId{};
                 fn.getAllyOrEnemyGroupId(&unitGroupId, battleMsgData, unitId, true);
 
-                getTargetsToAttackForCustomAttackReach(objectMap, battleMsgData, batAttack,
+                getTargetsToAttackForCustomAttackReach(objectMap, battleMsgData, batAttack, attack,
                                                        &targetGroupId, targetUnitId, &unitGroupId,
                                                        unitId, custom, value);
                 return true;
@@ -669,7 +664,7 @@ void __stdcall fillTargetsListHooked(const game::IMidgardObjectMap* objectMap,
     } else {
         for (const auto& custom : getCustomAttacks().reaches) {
             if (attackReach->id == custom.reach.id) {
-                fillTargetsListForCustomAttackReach(objectMap, battleMsgData, batAttack,
+                fillTargetsListForCustomAttackReach(objectMap, battleMsgData, batAttack, attack,
                                                     &targetGroupId, &unitGroupId, unitId,
                                                     attackUnitOrItemId, custom, value);
                 break;
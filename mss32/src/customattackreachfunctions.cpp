@@ -0,0 +1,47 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Stanislav Egorov.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "customattackreachfunctions.h"
+#include "customattacks.h"
+#include "scripts.h"
+#include "utils.h"
+
+namespace hooks {
+
+CustomAttackReachFunctions::CustomAttackReachFunctions(const CustomAttackReach& attackReach)
+{
+    getSelectionTargets = getScriptFunction(scriptsFolder() / attackReach.selectionScript,
+                                            "getTargets", selectionEnvironment, true, true);
+    getAttackTargets = getScriptFunction(scriptsFolder() / attackReach.attackScript,
+                                         "getTargets", attackEnvironment, true, true);
+}
+
+const CustomAttackReachFunctions& getCustomAttackReachFunctions(
+    const CustomAttackReach& attackReach)
+{
+    auto& functions = attackReach.functions[getLuaIndex()];
+    if (functions == nullptr) {
+        // Functions need to be initialized in a corresponding thread to use its own Lua instance
+        functions = std::make_unique<CustomAttackReachFunctions>(attackReach);
+    }
+
+    return *functions;
+}
+
+} // namespace hooks
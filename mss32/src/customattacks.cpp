@@ -18,6 +18,7 @@
  */
 
 #include "customattacks.h"
+#include "customattackreachfunctions.h"
 #include "dbffile.h"
 #include "log.h"
 #include "utils.h"
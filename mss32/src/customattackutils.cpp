@@ -28,6 +28,7 @@
 #include "batattackutils.h"
 #include "battlemsgdata.h"
 #include "battlemsgdataview.h"
+#include "customattackreachfunctions.h"
 #include "custommodifier.h"
 #include "dbffile.h"
 #include "dynamiccast.h"
@@ -48,10 +49,104 @@
 #include "unitutils.h"
 #include "ussoldier.h"
 #include "utils.h"
+#include <atomic>
 #include <fmt/format.h>
+#include <tuple>
 
 namespace hooks {
 
+/**
+ * Memoizes target candidates of custom attack reaches.
+ * The same candidates are requested many times per battle turn: when marking targets under cursor,
+ * when filling targets list and when AI chooses a target.
+ * Entries are bound to battle version, so any change of battle or units state makes them stale.
+ * Results of reach scripts are not cached, since scripts can read any scenario state.
+ */
+struct CustomAttackTargetsCache
+{
+    struct Key
+    {
+        const game::IMidgardObjectMap* objectMap;
+        const game::BattleMsgData* battleMsgData;
+        const void* batAttackType;
+        game::CMidgardID attackId;
+        game::CMidgardID unitId;
+        game::CMidgardID selectedUnitId;
+        game::CMidgardID targetGroupId;
+        game::CMidgardID itemId;
+
+        bool operator==(const Key& other) const
+        {
+            return std::tie(objectMap, battleMsgData, batAttackType, attackId, unitId,
+                            selectedUnitId, targetGroupId, itemId)
+                   == std::tie(other.objectMap, other.battleMsgData, other.batAttackType,
+                               other.attackId, other.unitId, other.selectedUnitId,
+                               other.targetGroupId, other.itemId);
+        }
+    };
+
+    std::vector<std::pair<Key, UnitSlots>> entries;
+    std::uint32_t battleVersion{};
+    std::uint32_t hits{};
+    std::uint32_t misses{};
+};
+
+/** Limits number of cached entries of a single battle version. */
+static const std::size_t targetsCacheEntriesMax{128};
+
+static std::atomic<std::uint32_t> battleVersion{};
+
+static CustomAttackTargetsCache& getTargetsCache()
+{
+    // AI and user interface can request targets from different threads
+    static thread_local CustomAttackTargetsCache cache;
+
+    const auto version = battleVersion.load();
+    if (cache.battleVersion != version) {
+        if (cache.hits || cache.misses) {
+            logDebug("customAttacks.log",
+                     fmt::format("Targets cache hits {:d}, misses {:d}", cache.hits,
+                                 cache.misses));
+        }
+
+        cache.entries.clear();
+        cache.battleVersion = version;
+        cache.hits = 0;
+        cache.misses = 0;
+    }
+
+    return cache;
+}
+
+static const UnitSlots* findCachedTargets(const CustomAttackTargetsCache::Key& key)
+{
+    auto& cache = getTargetsCache();
+    for (const auto& [entryKey, targets] : cache.entries) {
+        if (entryKey == key) {
+            ++cache.hits;
+            return &targets;
+        }
+    }
+
+    ++cache.misses;
+    return nullptr;
+}
+
+static void cacheTargets(const CustomAttackTargetsCache::Key& key, const UnitSlots& targets)
+{
+    auto& cache = getTargetsCache();
+    if (cache.entries.size() >= targetsCacheEntriesMax) {
+        cache.entries.clear();
+    }
+
+    cache.entries.emplace_back(key, targets);
+}
+
+void increaseBattleVersion()
+{
+    ++battleVersion;
+}
+
 void fillCustomAttackSources(const std::filesystem::path& dbfFilePath)
 {
     using namespace game;
@@ -174,12 +269,123 @@ void fillCustomAttackReaches(const std::filesystem::path& dbfFilePath)
                                                   (AttackReachId)emptyCategoryId},
                                      text, reachTxt, targetsTxt, trimSpaces(selectionScript),
                                      trimSpaces(attackScript), markAttackTargets, melee,
-                                     (std::uint32_t)maxTargets});
+                                     (std::uint32_t)maxTargets, {}});
+        }
+    }
+}
+
+void fillAttackClassAiRatings(const std::filesystem::path& dbfFilePath)
+{
+    using namespace game;
+
+    // Same values as hardcoded in the game
+    static const std::array<std::pair<const char*, double>, 16> baseRatings = {{
+        {"L_PARALYZE", 30.0},
+        {"L_PETRIFY", 30.0},
+        {"L_DAMAGE", 1.0},
+        {"L_HEAL", 1.0},
+        {"L_DRAIN", 1.5},
+        {"L_FEAR", 30.0},
+        {"L_BOOST_DAMAGE", 40.0},
+        {"L_BESTOW_WARDS", 40.0},
+        {"L_SHATTER", 30.0},
+        {"L_LOWER_DAMAGE", 40.0},
+        {"L_LOWER_INITIATIVE", 40.0},
+        {"L_DRAIN_OVERFLOW", 2.0},
+        {"L_SUMMON", 200.0},
+        {"L_DRAIN_LEVEL", 100.0},
+        {"L_GIVE_ATTACK", 50.0},
+        {"L_DOPPELGANGER", 200.0},
+    }};
+
+    static const double defaultRating = 1.0;
+    static const double transformSelfRating = 100.0;
+    static const double transformOtherRating = 60.0;
+
+    utils::DbfFile dbf;
+    if (!dbf.open(dbfFilePath)) {
+        logError("mssProxyError.log",
+                 fmt::format("Could not open {:s}", dbfFilePath.filename().string()));
+        return;
+    }
+
+    auto& ratings = getCustomAttacks().attackClassAiRatings;
+    ratings.clear();
+
+    const auto recordsTotal{dbf.recordsTotal()};
+    for (std::uint32_t i = 0; i < recordsTotal; ++i) {
+        utils::DbfRecord record;
+        if (!dbf.record(record, i)) {
+            logError("mssProxyError.log", fmt::format("Could not read record {:d} from {:s}", i,
+                                                      dbfFilePath.filename().string()));
+            return;
+        }
+
+        if (record.isDeleted()) {
+            continue;
         }
+
+        int id = emptyCategoryId;
+        if (!record.value(id, "ID") || id < 0) {
+            continue;
+        }
+
+        std::string text;
+        record.value(text, "TEXT");
+        text = trimSpaces(text);
+
+        double rating = defaultRating;
+        if (text == "L_TRANSFORM_SELF") {
+            rating = transformSelfRating;
+        } else if (text == "L_TRANSFORM_OTHER") {
+            rating = transformOtherRating;
+        } else {
+            auto it = std::find_if(baseRatings.begin(), baseRatings.end(),
+                                   [&text](const auto& base) { return text == base.first; });
+            if (it != baseRatings.end())
+                rating = it->second;
+        }
+
+        if (record.value(rating, aiRatingColumnName)) {
+            logDebug("customAttacks.log",
+                     fmt::format("Attack class {:s} ai rating {:f}", text, rating));
+        }
+
+        if (ratings.size() <= static_cast<std::size_t>(id))
+            ratings.resize(id + 1, defaultRating);
+
+        ratings[id] = rating;
+    }
+}
+
+void fillCustomAttackReachesById()
+{
+    auto& customAttacks = getCustomAttacks();
+    auto& reaches = customAttacks.reachesById;
+    reaches.clear();
+
+    for (const auto& custom : customAttacks.reaches) {
+        const auto id = static_cast<int>(custom.reach.id);
+        if (id < 0)
+            continue;
+
+        if (reaches.size() <= static_cast<std::size_t>(id))
+            reaches.resize(id + 1, nullptr);
+
+        reaches[id] = &custom;
     }
 }
 
-UnitSlots getTargetsToSelectOrAttack(const std::string& scriptFile,
+const CustomAttackReach* findCustomAttackReach(game::AttackReachId id)
+{
+    const auto& reaches = getCustomAttacks().reachesById;
+
+    const auto index = static_cast<std::size_t>(id);
+    return index < reaches.size() ? reaches[index] : nullptr;
+}
+
+UnitSlots getTargetsToSelectOrAttack(const CustomAttackReach& attackReach,
+                                     bool selection,
                                      const bindings::UnitSlotView& attacker,
                                      const bindings::UnitSlotView& selected,
                                      const UnitSlots& allies,
@@ -189,9 +395,9 @@ UnitSlots getTargetsToSelectOrAttack(const std::string& scriptFile,
                                      const bindings::BattleMsgDataView& battle,
                                      bool isMarking)
 {
-    std::optional<sol::environment> env;
-    const auto path{scriptsFolder() / scriptFile};
-    auto getTargets = getScriptFunction(path, "getTargets", env, true, true);
+    const LuaLease lease;
+    const auto& functions = getCustomAttackReachFunctions(attackReach);
+    const auto& getTargets = selection ? functions.getSelectionTargets : functions.getAttackTargets;
     if (!getTargets) {
         return UnitSlots();
     }
@@ -201,9 +407,10 @@ UnitSlots getTargetsToSelectOrAttack(const std::string& scriptFile,
                                           item ? &item.value() : nullptr, battle, isMarking);
         return result.as<UnitSlots>();
     } catch (const std::exception& e) {
+        const auto& scriptFile = selection ? attackReach.selectionScript : attackReach.attackScript;
         showErrorMessageBox(fmt::format("Failed to run '{:s}' script.\n"
                                         "Reason: '{:s}'",
-                                        path.string(), e.what()));
+                                        (scriptsFolder() / scriptFile).string(), e.what()));
         return UnitSlots();
     }
 }
@@ -211,12 +418,25 @@ UnitSlots getTargetsToSelectOrAttack(const std::string& scriptFile,
 UnitSlots getTargets(const game::IMidgardObjectMap* objectMap,
                      const game::BattleMsgData* battleMsgData,
                      const game::IBatAttack* batAttack,
+                     const game::IAttack* attack,
                      const game::CMidgardID* targetGroupId,
                      const game::CMidgardID* unitId,
                      const game::CMidgardID* selectedUnitId)
 {
     using namespace game;
 
+    const CustomAttackTargetsCache::Key cacheKey{objectMap,
+                                                 battleMsgData,
+                                                 batAttack->vftable,
+                                                 attack ? attack->id : emptyId,
+                                                 *unitId,
+                                                 *selectedUnitId,
+                                                 *targetGroupId,
+                                                 *getItemId(batAttack)};
+    if (auto cached = findCachedTargets(cacheKey)) {
+        return *cached;
+    }
+
     const auto& fn = gameFunctions();
     const auto& battle = BattleMsgDataApi::get();
     const auto& rtti = RttiApi::rtti();
@@ -258,6 +478,7 @@ UnitSlots getTargets(const game::IMidgardObjectMap* objectMap,
         }
     }
 
+    cacheTargets(cacheKey, value);
     return value;
 }
 
@@ -299,6 +520,7 @@ std::vector<bindings::UnitSlotView> getAllies(const game::IMidgardObjectMap* obj
 void fillTargetsListForCustomAttackReach(const game::IMidgardObjectMap* objectMap,
                                          const game::BattleMsgData* battleMsgData,
                                          const game::IBatAttack* batAttack,
+                                         const game::IAttack* attack,
                                          const game::CMidgardID* targetGroupId,
                                          const game::CMidgardID* unitGroupId,
                                          const game::CMidgardID* unitId,
@@ -324,7 +546,8 @@ void fillTargetsListForCustomAttackReach(const game::IMidgardObjectMap* objectMa
 
     bindings::UnitSlotView selected(nullptr, -1, &emptyId);
 
-    auto targets = getTargets(objectMap, battleMsgData, batAttack, targetGroupId, unitId, &emptyId);
+    auto targets = getTargets(objectMap, battleMsgData, batAttack, attack, targetGroupId, unitId,
+                              &emptyId);
     auto allies = getAllies(objectMap, battleMsgData, unitGroupId, unitId);
 
     std::optional<bindings::ItemView> item;
@@ -333,10 +556,9 @@ void fillTargetsListForCustomAttackReach(const game::IMidgardObjectMap* objectMa
     }
 
     bindings::BattleMsgDataView battleView{battleMsgData, objectMap};
-    auto targetsToSelect = getTargetsToSelectOrAttack(attackReach.selectionScript, attacker,
-                                                      selected, allies, targets,
-                                                      *unitGroupId == *targetGroupId, item,
-                                                      battleView, false);
+    auto targetsToSelect = getTargetsToSelectOrAttack(attackReach, true, attacker, selected, allies,
+                                                      targets, *unitGroupId == *targetGroupId,
+                                                      item, battleView, false);
 
     bool isSummonAttack = batAttack->vftable->method17(batAttack, battleMsgData);
     for (const auto& target : targetsToSelect) {
@@ -395,6 +617,7 @@ void getTargetsToAttackForAllAttackReach(const game::IMidgardObjectMap* objectMa
 UnitSlots getTargetsToMarkOrAttackForCustomAttackReach(const game::IMidgardObjectMap* objectMap,
                                                        const game::BattleMsgData* battleMsgData,
                                                        const game::IBatAttack* batAttack,
+                                                       const game::IAttack* attack,
                                                        const game::CMidgardID* targetGroupId,
                                                        const game::CMidgardID* targetUnitId,
                                                        const game::CMidgardID* unitGroupId,
@@ -423,31 +646,33 @@ UnitSlots getTargetsToMarkOrAttackForCustomAttackReach(const game::IMidgardObjec
     }
     bindings::UnitSlotView selected(target, targetPosition, targetGroupId);
 
-    auto targets = getTargets(objectMap, battleMsgData, batAttack, targetGroupId, unitId,
+    auto itemId = getItemId(batAttack);
+
+    auto targets = getTargets(objectMap, battleMsgData, batAttack, attack, targetGroupId, unitId,
                               targetUnitId);
     auto allies = getAllies(objectMap, battleMsgData, unitGroupId, unitId);
 
     std::optional<bindings::ItemView> item;
-    auto itemId = getItemId(batAttack);
     if (*itemId != emptyId) {
         item = bindings::ItemView(itemId, objectMap);
     }
 
     bindings::BattleMsgDataView battleView{battleMsgData, objectMap};
-    return getTargetsToSelectOrAttack(attackReach.attackScript, attacker, selected, allies, targets,
+    return getTargetsToSelectOrAttack(attackReach, false, attacker, selected, allies, targets,
                                       *unitGroupId == *targetGroupId, item, battleView, isMarking);
 }
 
 UnitSlots getTargetsToAttackForCustomAttackReach(const game::IMidgardObjectMap* objectMap,
                                                  const game::BattleMsgData* battleMsgData,
                                                  const game::IBatAttack* batAttack,
+                                                 const game::IAttack* attack,
                                                  const game::CMidgardID* targetGroupId,
                                                  const game::CMidgardID* targetUnitId,
                                                  const game::CMidgardID* unitGroupId,
                                                  const game::CMidgardID* unitId,
                                                  const CustomAttackReach& attackReach)
 {
-    return getTargetsToMarkOrAttackForCustomAttackReach(objectMap, battleMsgData, batAttack,
+    return getTargetsToMarkOrAttackForCustomAttackReach(objectMap, battleMsgData, batAttack, attack,
                                                         targetGroupId, targetUnitId, unitGroupId,
                                                         unitId, attackReach, false);
 }
@@ -471,7 +696,7 @@ UnitSlots getTargetsToMarkForCustomAttackReach(const game::IMidgardObjectMap* ob
                                               attackClass, false);
 
     auto result = getTargetsToMarkOrAttackForCustomAttackReach(objectMap, battleMsgData, batAttack,
-                                                               targetGroupId, targetUnitId,
+                                                               attack, targetGroupId, targetUnitId,
                                                                unitGroupId, unitId, attackReach,
                                                                true);
 
@@ -482,6 +707,7 @@ UnitSlots getTargetsToMarkForCustomAttackReach(const game::IMidgardObjectMap* ob
 void getTargetsToAttackForCustomAttackReach(const game::IMidgardObjectMap* objectMap,
                                             const game::BattleMsgData* battleMsgData,
                                             const game::IBatAttack* batAttack,
+                                            const game::IAttack* attack,
                                             const game::CMidgardID* targetGroupId,
                                             const game::CMidgardID* targetUnitId,
                                             const game::CMidgardID* unitGroupId,
@@ -494,8 +720,8 @@ void getTargetsToAttackForCustomAttackReach(const game::IMidgardObjectMap* objec
     const auto& id = CMidgardIDApi::get();
 
     auto targets = getTargetsToAttackForCustomAttackReach(objectMap, battleMsgData, batAttack,
-                                                          targetGroupId, targetUnitId, unitGroupId,
-                                                          unitId, attackReach);
+                                                          attack, targetGroupId, targetUnitId,
+                                                          unitGroupId, unitId, attackReach);
     for (const auto& target : targets) {
         CMidgardID targetUnitId = target.getUnitId();
         if (targetUnitId == emptyId) {
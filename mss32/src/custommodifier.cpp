@@ -34,6 +34,7 @@
 #include "midunit.h"
 #include "restrictions.h"
 #include "scriptutils.h"
+#include "settings.h"
 #include "unitcat.h"
 #include "unitimplview.h"
 #include "unitmodifier.h"
@@ -41,9 +42,14 @@
 #include "unitutils.h"
 #include "ussoldierimpl.h"
 #include "utils.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <fmt/format.h>
 #include <mutex>
 #include <set>
+#include <stdexcept>
+#include <string_view>
 
 namespace hooks {
 
@@ -73,6 +79,66 @@ static struct
 void initRttiInfo();
 void initVftable(CCustomModifier* thisptr);
 
+CustomModifierStatistics& getCustomModifierStatistics()
+{
+    static CustomModifierStatistics statistics{};
+
+    return statistics;
+}
+
+/**
+ * Scope of a unit stat query of the calling thread, nested queries share the outermost one.
+ * Stats of previous modifiers read by getAllStats are queried within the same scope,
+ * so each modifier in a chain calls getAllStats once per query.
+ */
+class CustomModifierStatsQuery
+{
+public:
+    CustomModifierStatsQuery()
+    {
+        if (depth++ == 0) {
+            id = nextId.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    ~CustomModifierStatsQuery()
+    {
+        if (--depth == 0) {
+            id = 0;
+        }
+    }
+
+    CustomModifierStatsQuery(const CustomModifierStatsQuery&) = delete;
+    CustomModifierStatsQuery& operator=(const CustomModifierStatsQuery&) = delete;
+
+    /** Returns id of the current query, unique among all threads. */
+    static std::uint32_t currentId()
+    {
+        return id;
+    }
+
+private:
+    static std::atomic<std::uint32_t> nextId;
+    static thread_local std::uint32_t id;
+    static thread_local std::uint32_t depth;
+};
+
+// Zero marks data that belongs to no query
+std::atomic<std::uint32_t> CustomModifierStatsQuery::nextId{1};
+thread_local std::uint32_t CustomModifierStatsQuery::id{};
+thread_local std::uint32_t CustomModifierStatsQuery::depth{};
+
+void countScriptCall(bool cached)
+{
+    if (!userSettings().debugMode) {
+        return;
+    }
+
+    auto& statistics = getCustomModifierStatistics();
+    auto& counter = cached ? statistics.cachedCalls : statistics.scriptCalls;
+    counter.fetch_add(1, std::memory_order_relaxed);
+}
+
 static inline CCustomModifier* castUnitToCustomModifier(const game::IUsUnit* unit)
 {
     return (CCustomModifier*)unit;
@@ -203,17 +269,108 @@ CustomAttackData CCustomModifier::getCustomAttackData(const game::IAttack* thisp
     return value;
 }
 
-CustomModifierData& CCustomModifier::getData()
+/** Data slot indices of exited threads, reused by new threads. */
+struct CustomModifierDataSlotIndices
+{
+    std::mutex mutex;
+    std::set<std::size_t> released;
+    std::size_t taken{};
+};
+
+static CustomModifierDataSlotIndices& getDataSlotIndices()
 {
+    static CustomModifierDataSlotIndices indices;
+
+    return indices;
+}
+
+/** Data slot index of a thread, returned for reuse when the thread exits. */
+struct CustomModifierDataSlotLease
+{
+    CustomModifierDataSlotLease()
+    {
+        auto& indices = getDataSlotIndices();
+        const std::lock_guard<std::mutex> lock(indices.mutex);
+
+        // Lowest index first, so lock-free slots are reused before the map
+        if (!indices.released.empty()) {
+            index = *indices.released.begin();
+            indices.released.erase(indices.released.begin());
+        } else {
+            index = indices.taken++;
+        }
+    }
+
+    ~CustomModifierDataSlotLease()
+    {
+        auto& indices = getDataSlotIndices();
+        const std::lock_guard<std::mutex> lock(indices.mutex);
+        indices.released.insert(index);
+    }
+
+    std::size_t index;
+};
+
+static std::size_t getDataSlotIndex()
+{
+    static thread_local const CustomModifierDataSlotLease lease;
+
+    return lease.index;
+}
+
+static CustomModifierData* createData()
+{
+    auto data = new CustomModifierData{};
+    game::IdVectorApi::get().reserve(&data->wards, 1);
+
+    return data;
+}
+
+static void destroyData(CustomModifierData* data)
+{
+    game::IdVectorApi::get().destructor(&data->wards);
+    delete data;
+}
+
+/** Destroys data of slots released by exited threads. */
+static void eraseReleasedData(CustomModifierDataMap& dataMap)
+{
+    auto& indices = getDataSlotIndices();
+    const std::lock_guard<std::mutex> lock(indices.mutex);
+
+    for (auto it = dataMap.begin(); it != dataMap.end();) {
+        if (indices.released.count(it->first)) {
+            destroyData(it->second);
+            it = dataMap.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+CustomModifierData& CCustomModifier::getData() const
+{
+    const auto index = getDataSlotIndex();
+    if (index < data.size()) {
+        // Slot is only accessed by the thread that owns it, no need to lock
+        auto& slot = data[index];
+        if (slot == nullptr) {
+            slot = createData();
+        }
+
+        return *slot;
+    }
+
     const std::lock_guard<std::mutex> lock(dataMutex);
 
-    auto result = data.emplace(std::this_thread::get_id(), CustomModifierData{});
-    if (result.second) {
-        auto& wards = result.first->second.wards;
-        game::IdVectorApi::get().reserve(&wards, 1);
+    auto it = dataMap.find(index);
+    if (it == dataMap.end()) {
+        // Map only grows with new threads, drop data of the ones that exited
+        eraseReleasedData(dataMap);
+        it = dataMap.emplace(index, createData()).first;
     }
 
-    return result.first->second;
+    return *it->second;
 }
 
 void CCustomModifier::setUnit(const game::CMidUnit* value)
@@ -327,7 +484,11 @@ void CCustomModifier::showInvalidRetvalMessage(const char* functionName, const c
 
 void CCustomModifier::notifyModifiersChanged() const
 {
-    auto f = getCustomModifierFunctions(unitModifier).onModifiersChanged;
+    // Pure results do not depend on modifiers, clearing just keeps the cache small
+    getData().pureValues.clear();
+
+    const LuaLease lease;
+    const auto& f = getCustomModifierFunctions(unitModifier).onModifiersChanged;
     try {
         if (f) {
             bindings::UnitView unitView{unit};
@@ -338,6 +499,185 @@ void CCustomModifier::notifyModifiersChanged() const
     }
 }
 
+bool CCustomModifier::isPure() const
+{
+    return getCustomModifierFunctions(unitModifier).pure;
+}
+
+struct AllStatsEntry
+{
+    const char* functionName;
+    const char* statName;
+    std::optional<int> (*getPrevValue)(const CCustomModifier* modifier);
+};
+
+template <typename F>
+static std::optional<int> getPrevSoldierValue(const CCustomModifier* modifier, F getter)
+{
+    auto prev = modifier->getPrevSoldier();
+    return prev ? std::optional<int>(getter(prev)) : std::nullopt;
+}
+
+template <typename F>
+static std::optional<int> getPrevStackLeaderValue(const CCustomModifier* modifier, F getter)
+{
+    auto prev = modifier->getPrevStackLeader();
+    return prev ? std::optional<int>(getter(prev)) : std::nullopt;
+}
+
+// clang-format off
+static const std::array<AllStatsEntry, 12> allStatsEntries{{
+    {"getHitPoint", "hitPoint", [](const CCustomModifier* modifier) {
+        return getPrevSoldierValue(modifier, [](const game::IUsSoldier* prev) {
+            return prev->vftable->getHitPoints(prev); });
+    }},
+    {"getArmor", "armor", [](const CCustomModifier* modifier) {
+        return getPrevSoldierValue(modifier, [](const game::IUsSoldier* prev) {
+            int armor{};
+            return *prev->vftable->getArmor(prev, &armor); });
+    }},
+    {"getRegen", "regen", [](const CCustomModifier* modifier) {
+        return getPrevSoldierValue(modifier, [](const game::IUsSoldier* prev) {
+            return *prev->vftable->getRegen(prev); });
+    }},
+    {"getXpNext", "xpNext", [](const CCustomModifier* modifier) {
+        return getPrevSoldierValue(modifier, [](const game::IUsSoldier* prev) {
+            return prev->vftable->getXpNext(prev); });
+    }},
+    {"getXpKilled", "xpKilled", [](const CCustomModifier* modifier) {
+        return getPrevSoldierValue(modifier, [](const game::IUsSoldier* prev) {
+            return prev->vftable->getXpKilled(prev); });
+    }},
+    {"getAtckTwice", "atckTwice", [](const CCustomModifier* modifier) {
+        return getPrevSoldierValue(modifier, [](const game::IUsSoldier* prev) {
+            return (int)prev->vftable->getAttackTwice(prev); });
+    }},
+    {"getMovement", "movement", [](const CCustomModifier* modifier) {
+        return getPrevStackLeaderValue(modifier, [](const game::IUsStackLeader* prev) {
+            return prev->vftable->getMovement(prev); });
+    }},
+    {"getScout", "scout", [](const CCustomModifier* modifier) {
+        return getPrevStackLeaderValue(modifier, [](const game::IUsStackLeader* prev) {
+            return prev->vftable->getScout(prev); });
+    }},
+    {"getLeadership", "leadership", [](const CCustomModifier* modifier) {
+        return getPrevStackLeaderValue(modifier, [](const game::IUsStackLeader* prev) {
+            return prev->vftable->getLeadership(prev); });
+    }},
+    {"getNegotiate", "negotiate", [](const CCustomModifier* modifier) {
+        return getPrevStackLeaderValue(modifier, [](const game::IUsStackLeader* prev) {
+            return prev->vftable->getNegotiate(prev); });
+    }},
+    {"getFastRetreat", "fastRetreat", [](const CCustomModifier* modifier) {
+        return getPrevStackLeaderValue(modifier, [](const game::IUsStackLeader* prev) {
+            return (int)prev->vftable->getFastRetreat(prev); });
+    }},
+    {"getLowerCost", "lowerCost", [](const CCustomModifier* modifier) {
+        return getPrevStackLeaderValue(modifier, [](const game::IUsStackLeader* prev) {
+            return prev->vftable->getLowerCost(prev); });
+    }},
+}};
+// clang-format on
+
+static const AllStatsEntry* findAllStatsEntry(const char* functionName)
+{
+    auto it = std::find_if(allStatsEntries.begin(), allStatsEntries.end(),
+                           [functionName](const AllStatsEntry& entry) {
+                               return std::strcmp(entry.functionName, functionName) == 0;
+                           });
+
+    return it != allStatsEntries.end() ? &*it : nullptr;
+}
+
+std::optional<int> CCustomModifier::getAllStatsValue(const char* functionName) const
+{
+    const LuaLease lease;
+    const auto& getAllStats = getCustomModifierFunctions(unitModifier).getAllStats;
+    if (!getAllStats || !unit || !findAllStatsEntry(functionName)) {
+        return std::nullopt;
+    }
+
+    const CustomModifierStatsQuery query;
+    auto& allStats = getData().allStats;
+
+    const auto prev = getPrev();
+    if (allStats.queryId == query.currentId() && allStats.prev == prev) {
+        auto it = allStats.values.find(std::string_view(functionName));
+        if (it == allStats.values.end()) {
+            return std::nullopt;
+        }
+
+        countScriptCall(true);
+        return it->second;
+    }
+
+    // Validate before the call, so script accessing stats of the same unit falls back to
+    // per-stat functions instead of endless recursion
+    allStats.queryId = query.currentId();
+    allStats.prev = prev;
+    allStats.values.clear();
+
+    std::map<std::string, int, std::less<>> values;
+    try {
+        auto& lua = getLua();
+
+        // Previous values are evaluated on first access, each one walks the modifiers chain
+        auto prevValues = lua.create_table();
+        auto prevMetatable = lua.create_table();
+        prevMetatable[sol::meta_function::index] =
+            [this](sol::table table, const std::string& statName) -> sol::object {
+            for (const auto& entry : allStatsEntries) {
+                if (statName != entry.statName) {
+                    continue;
+                }
+
+                const auto value = entry.getPrevValue(this);
+                if (!value) {
+                    break;
+                }
+
+                table.raw_set(statName, *value);
+                return sol::make_object(table.lua_state(), *value);
+            }
+
+            return sol::lua_nil;
+        };
+        prevValues[sol::metatable_key] = prevMetatable;
+
+        countScriptCall(false);
+        bindings::UnitView unitView{unit, prev};
+        const sol::object object = (*getAllStats)(unitView, prevValues);
+
+        // Script could keep the table, detach it from the modifier
+        prevValues[sol::metatable_key] = sol::lua_nil;
+
+        if (!object.is<sol::table>()) {
+            throw std::runtime_error("getAllStats should return a table");
+        }
+
+        const auto result = object.as<sol::table>();
+        for (const auto& entry : allStatsEntries) {
+            const sol::object value = result[entry.statName];
+            if (value.is<bool>()) {
+                values[entry.functionName] = value.as<bool>() ? 1 : 0;
+            } else if (value.is<int>()) {
+                values[entry.functionName] = value.as<int>();
+            }
+        }
+    } catch (const std::exception& e) {
+        showScriptErrorMessage("getAllStats", e.what());
+    }
+
+    allStats.values = std::move(values);
+
+    auto it = allStats.values.find(std::string_view(functionName));
+    if (it == allStats.values.end()) {
+        return std::nullopt;
+    }
+
+    return it->second;
+}
+
 game::CMidgardID CCustomModifier::getUnitNameTxt() const
 {
     auto prev = getPrevCustomModifier();
@@ -419,7 +759,8 @@ CCustomModifier* customModifierCtor(CCustomModifier* thisptr,
     const_cast<CMidgardID&>(thisptr->descTxt) = *descTxt;
     const_cast<bool&>(thisptr->display) = display;
     new (const_cast<std::string*>(&thisptr->scriptFileName)) std::string(scriptFileName);
-    new (&thisptr->data) CustomModifierDataMap();
+    thisptr->data.fill(nullptr);
+    new (&thisptr->dataMap) CustomModifierDataMap();
     new (&thisptr->dataMutex) std::mutex();
 
     initVftable(thisptr);
@@ -442,7 +783,8 @@ CCustomModifier* customModifierCopyCtor(CCustomModifier* thisptr, const CCustomM
     const_cast<CMidgardID&>(thisptr->descTxt) = src->descTxt;
     const_cast<bool&>(thisptr->display) = src->display;
     new (const_cast<std::string*>(&thisptr->scriptFileName)) std::string(src->scriptFileName);
-    new (&thisptr->data) CustomModifierDataMap(); // No copy required
+    thisptr->data.fill(nullptr); // No copy required
+    new (&thisptr->dataMap) CustomModifierDataMap();
     new (&thisptr->dataMutex) std::mutex();
 
     initVftable(thisptr);
@@ -456,10 +798,16 @@ void customModifierDtor(CCustomModifier* thisptr, char flags)
 
     thisptr->scriptFileName.~basic_string();
 
-    for (auto& data : thisptr->data) {
-        IdVectorApi::get().destructor(&data.second.wards);
+    for (auto data : thisptr->data) {
+        if (data) {
+            destroyData(data);
+        }
+    }
+
+    for (auto& [index, data] : thisptr->dataMap) {
+        destroyData(data);
     }
-    thisptr->data.~map();
+    thisptr->dataMap.~map();
     thisptr->dataMutex.~mutex();
 
     CUmModifierApi::get().destructor(&thisptr->umModifier);
@@ -824,7 +1172,8 @@ bool __fastcall modifierCanApplyToUnit(const game::CUmModifier* thisptr,
 {
     auto thiz = castModifierToCustomModifier(thisptr);
 
-    auto f = getCustomModifierFunctions(thiz->unitModifier).canApplyToUnit;
+    const LuaLease lease;
+    const auto& f = getCustomModifierFunctions(thiz->unitModifier).canApplyToUnit;
     try {
         if (f) {
             bindings::UnitImplView unitImplView{unit};
@@ -843,7 +1192,8 @@ bool __fastcall modifierCanApplyToUnitCategory(const game::CUmModifier* thisptr,
 {
     auto thiz = castModifierToCustomModifier(thisptr);
 
-    auto f = getCustomModifierFunctions(thiz->unitModifier).canApplyToUnitType;
+    const LuaLease lease;
+    const auto& f = getCustomModifierFunctions(thiz->unitModifier).canApplyToUnitType;
     try {
         if (f) {
             return (*f)((int)unitCategory->id);
@@ -24,6 +24,7 @@
 #include "unitimplview.h"
 #include "unitview.h"
 #include "utils.h"
+#include <fmt/format.h>
 
 namespace hooks {
 
@@ -36,7 +37,21 @@ CustomModifierFunctions::CustomModifierFunctions(const std::string& scriptFileNa
 #define FUNCTION(_NAME_) this->##_NAME_ = getScriptFunction(env, #_NAME_);
 
     const auto& env = *environment;
+
+    auto isPure = getScriptFunction(env, "isPure");
+    if (isPure) {
+        try {
+            pure = (*isPure)();
+        } catch (const std::exception& e) {
+            showErrorMessageBox(fmt::format("Failed to run '{:s}' script.\n"
+                                            "Function: 'isPure'\n"
+                                            "Reason: '{:s}'",
+                                            scriptFileName, e.what()));
+        }
+    }
+
     FUNCTION(onModifiersChanged)
+    FUNCTION(getAllStats)
     FUNCTION(canApplyToUnit)
     FUNCTION(canApplyToUnitType)
     FUNCTION(canApplyAsLowerSpell)
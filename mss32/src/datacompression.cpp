@@ -0,0 +1,207 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "datacompression.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace hooks {
+
+// Block format is a sequence of:
+// token (literals count << 4 | match length - minMatch),
+// extra literals count bytes, literals, 16-bit match offset, extra match length bytes.
+// Counts of 15 in token are continued with bytes until byte is less than 255.
+// Last sequence contains only literals.
+static constexpr std::uint32_t minMatch{4};
+static constexpr std::uint32_t maxOffset{0xffff};
+/** Matches are not searched at the end of data, it is encoded as literals. */
+static constexpr std::uint32_t lastLiterals{12};
+static constexpr std::uint32_t hashBits{12};
+
+static std::uint32_t read32(const unsigned char* data)
+{
+    std::uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static std::uint32_t hash(std::uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - hashBits);
+}
+
+static void writeLength(std::vector<unsigned char>& result, std::uint32_t length)
+{
+    for (; length >= 255; length -= 255) {
+        result.push_back(255);
+    }
+
+    result.push_back(static_cast<unsigned char>(length));
+}
+
+static void writeSequence(std::vector<unsigned char>& result,
+                          const unsigned char* literals,
+                          std::uint32_t literalsCount,
+                          std::uint32_t offset,
+                          std::uint32_t matchLength)
+{
+    const std::uint32_t matchCount{matchLength ? matchLength - minMatch : 0};
+    const auto token = static_cast<unsigned char>((std::min(literalsCount, 15u) << 4)
+                                                  | std::min(matchCount, 15u));
+    result.push_back(token);
+
+    if (literalsCount >= 15) {
+        writeLength(result, literalsCount - 15);
+    }
+
+    result.insert(result.end(), literals, literals + literalsCount);
+
+    if (!matchLength) {
+        return;
+    }
+
+    result.push_back(static_cast<unsigned char>(offset & 0xff));
+    result.push_back(static_cast<unsigned char>(offset >> 8));
+
+    if (matchCount >= 15) {
+        writeLength(result, matchCount - 15);
+    }
+}
+
+bool compressData(const unsigned char* data,
+                  std::uint32_t size,
+                  std::vector<unsigned char>& result)
+{
+    result.clear();
+    result.reserve(size);
+
+    std::array<std::uint32_t, 1 << hashBits> positions{};
+
+    std::uint32_t anchor{};
+    std::uint32_t i{};
+    const std::uint32_t limit{size > lastLiterals ? size - lastLiterals : 0};
+
+    while (i < limit) {
+        const auto sequence{read32(data + i)};
+        auto& position{positions[hash(sequence)]};
+        const auto candidate{position};
+        position = i;
+
+        if (candidate >= i || i - candidate > maxOffset || read32(data + candidate) != sequence) {
+            ++i;
+            continue;
+        }
+
+        std::uint32_t matchLength{minMatch};
+        while (i + matchLength < limit && data[candidate + matchLength] == data[i + matchLength]) {
+            ++matchLength;
+        }
+
+        writeSequence(result, data + anchor, i - anchor, i - candidate, matchLength);
+        if (result.size() >= size) {
+            return false;
+        }
+
+        i += matchLength;
+        anchor = i;
+    }
+
+    writeSequence(result, data + anchor, size - anchor, 0, 0);
+    return result.size() < size;
+}
+
+static bool readLength(const unsigned char* data,
+                       std::uint32_t size,
+                       std::uint32_t& position,
+                       std::uint32_t& length)
+{
+    unsigned char value;
+    do {
+        if (position >= size) {
+            return false;
+        }
+
+        value = data[position++];
+        length += value;
+    } while (value == 255);
+
+    return true;
+}
+
+bool decompressData(const unsigned char* data,
+                    std::uint32_t size,
+                    unsigned char* result,
+                    std::uint32_t resultSize)
+{
+    std::uint32_t in{};
+    std::uint32_t out{};
+
+    while (in < size) {
+        const unsigned char token{data[in++]};
+
+        std::uint32_t literalsCount = token >> 4;
+        if (literalsCount == 15 && !readLength(data, size, in, literalsCount)) {
+            return false;
+        }
+
+        if (literalsCount > size - in || literalsCount > resultSize - out) {
+            return false;
+        }
+
+        std::memcpy(result + out, data + in, literalsCount);
+        in += literalsCount;
+        out += literalsCount;
+
+        if (in == size) {
+            // Last sequence
+            break;
+        }
+
+        if (size - in < 2) {
+            return false;
+        }
+
+        const std::uint32_t offset = data[in] | (data[in + 1] << 8);
+        in += 2;
+
+        if (offset == 0 || offset > out) {
+            return false;
+        }
+
+        std::uint32_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(data, size, in, matchLength)) {
+            return false;
+        }
+
+        matchLength += minMatch;
+        if (matchLength > resultSize - out) {
+            return false;
+        }
+
+        // Matches can overlap with output, copy byte by byte
+        for (std::uint32_t i = 0; i < matchLength; ++i, ++out) {
+            result[out] = result[out - offset];
+        }
+    }
+
+    return out == resultSize;
+}
+
+} // namespace hooks
@@ -133,6 +133,67 @@ bool DbfRecord::value(int& result, const DbfColumn& column) const
     return true;
 }
 
+bool DbfRecord::value(double& result, std::uint32_t columnIndex) const
+{
+    if (!dbf) {
+        return false;
+    }
+
+    const auto column = dbf->column(columnIndex);
+    if (!column) {
+        return false;
+    }
+
+    return value(result, *column);
+}
+
+bool DbfRecord::value(double& result, const std::string& columnName) const
+{
+    if (!dbf) {
+        return false;
+    }
+
+    const auto column = dbf->column(columnName);
+    if (!column) {
+        return false;
+    }
+
+    return value(result, *column);
+}
+
+bool DbfRecord::value(double& result, const DbfColumn& column) const
+{
+    if (data.empty()) {
+        return false;
+    }
+
+    if (column.type != ColumnType::Number) {
+        return false;
+    }
+
+    const char* first = reinterpret_cast<const char*>(&data[column.dataAddress]);
+    auto length = column.length;
+    // skip spaces at the start of the field to std::from_chars work properly
+    while (*first == ' ' && length) {
+        first++;
+        length--;
+    }
+
+    if (!length) {
+        return false;
+    }
+
+    const char* last = first + length;
+    double tmpResult{};
+    auto [p, ec] = std::from_chars(first, last, tmpResult);
+    if (ec != std::errc()) {
+        return false;
+    }
+
+    result = tmpResult;
+    return true;
+}
+
 bool DbfRecord::value(bool& result, std::uint32_t columnIndex) const
 {
     if (!dbf) {
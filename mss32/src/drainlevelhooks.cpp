@@ -55,13 +55,11 @@ static int getDrainLevel(const game::CMidUnit* unit,
 {
     using namespace game;
 
-    // The function is only accessed by the server thread - the single instance is enough.
-    static std::optional<sol::environment> env;
-    static std::optional<sol::function> getLevel;
+    // Function is loaded once in each lua instance
+    static OwnedLuaStateObjects<ScriptFunction> functions;
+    const LuaLease lease;
     const auto path{scriptsFolder() / "drainLevel.lua"};
-    if (!env && !getLevel) {
-        getLevel = getScriptFunction(path, "getLevel", env, true, true);
-    }
+    const auto& getLevel = getScriptFunction(functions, path, "getLevel", true, true);
     if (!getLevel) {
         return 0;
     }
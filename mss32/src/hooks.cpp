@@ -156,6 +156,8 @@
 #include "scenariodata.h"
 #include "scenariodataarray.h"
 #include "scenarioinfo.h"
+#include "scenvariablesindex.h"
+#include "scripts.h"
 #include "settings.h"
 #include "sitemerchantinterf.h"
 #include "sitemerchantinterfhooks.h"
@@ -1596,6 +1598,7 @@ void __stdcall afterBattleTurnHooked(game::BattleMsgData* battleMsgData,
     }
 
     currUnitId = *unitId;
+    increaseBattleVersion();
 }
 
 void __stdcall beforeBattleTurnHooked(game::BattleMsgData* battleMsgData,
@@ -1610,16 +1613,17 @@ void __stdcall beforeBattleTurnHooked(game::BattleMsgData* battleMsgData,
     // Fix bestow wards with double attack where modifiers granted by first attack are removed
     if (*unitId != currUnitId) {
         auto unitInfo = battle.getUnitInfoById(battleMsgData, unitId);
-        auto modifiedUnitIds = getModifiedUnitIds(unitInfo);
-        for (auto it = modifiedUnitIds.begin(); it != modifiedUnitIds.end(); it++)
-            removeModifiers(battleMsgData, objectMap, unitInfo, &(*it));
-        resetModifiedUnitsInfo(unitInfo);
+        const auto modifiedUnitIds = getModifiedUnitIds(unitInfo);
+        for (const auto& modifiedUnitId : modifiedUnitIds)
+            removeModifiers(battleMsgData, objectMap, unitInfo, &modifiedUnitId);
+        resetModifiedUnitsInfo(battleMsgData, unitInfo);
     }
 
     battle.setAttackPowerReduction(battleMsgData, unitId, 0);
 
     getCustomAttacks().targets.clear();
     getCustomAttacks().damageRatios.clear();
+    increaseBattleVersion();
 
     auto& freeTransformSelf = getCustomAttacks().freeTransformSelf;
     if (freeTransformSelf.unitId != *unitId) {
@@ -1994,6 +1998,8 @@ int __stdcall loadScenarioMapHooked(int a1,
                                     game::CMidStreamEnvFile* streamEnv,
                                     game::CMidgardScenarioMap* scenarioMap)
 {
+    resetScenarioVariablesIndex();
+    reloadScriptFiles();
     int result = getOriginalFunctions().loadScenarioMap(a1, streamEnv, scenarioMap);
 
     // Write-mode validation is done in midUnitStreamHooked
@@ -2006,6 +2012,11 @@ bool __fastcall scenarioMapStreamHooked(game::CMidgardScenarioMap* scenarioMap,
                                         int /*%edx*/,
                                         game::IMidgardStreamEnv* streamEnv)
 {
+    if (streamEnv->vftable->readMode(streamEnv)) {
+        resetScenarioVariablesIndex();
+        reloadScriptFiles();
+    }
+
     bool result = getOriginalFunctions().scenarioMapStream(scenarioMap, streamEnv);
     if (result && streamEnv->vftable->readMode(streamEnv)) {
         // Write-mode validation is done in midUnitStreamHooked
@@ -110,7 +110,8 @@ void RoomsListCallbacks::SearchByFilter_Callback(const SLNet::SystemAddress&,
                                                  SLNet::SearchByFilter_Func* callResult)
 {
     if (callResult->resultCode != SLNet::REC_SUCCESS) {
-        customLobbyShowError(SLNet::RoomsErrorCodeDescription::ToEnglish(callResult->resultCode));
+        customLobbyProcessRoomsSearchError(
+            menuLobby, SLNet::RoomsErrorCodeDescription::ToEnglish(callResult->resultCode));
         return;
     }
 
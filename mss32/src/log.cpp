@@ -20,38 +20,163 @@
 #include "log.h"
 #include "settings.h"
 #include "utils.h"
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 
 namespace hooks {
 
-static void logAction(const std::string& logFile, const std::string& message)
+/** How often background thread writes pending messages to files. */
+static constexpr std::chrono::milliseconds flushInterval{200};
+
+struct LogMessage
+{
+    LogMessage* next;
+    std::string logFile;
+    std::string message;
+    std::time_t time;
+    std::thread::id threadId;
+};
+
+/**
+ * Writes log messages in a background thread.
+ * Callers only push messages to a lock-free list, files are kept open by the writer
+ * and flushed periodically, on errors and on exit.
+ * The writer is started explicitly, messages pushed before that wait in the list.
+ */
+class Logger
 {
-    using namespace std::chrono;
+public:
+    void push(LogMessage* message, bool urgent)
+    {
+        message->next = pending.load(std::memory_order_relaxed);
+        while (!pending.compare_exchange_weak(message->next, message, std::memory_order_release,
+                                              std::memory_order_relaxed))
+            ;
+
+        if (urgent) {
+            wakeUp.notify_one();
+        }
+    }
+
+    void start()
+    {
+        std::call_once(threadStarted, [this]() { std::thread(&Logger::run, this).detach(); });
+    }
+
+    void flush(bool wait)
+    {
+        std::unique_lock<std::mutex> lock(writeMutex, std::defer_lock);
+        if (wait) {
+            lock.lock();
+        } else if (!lock.try_lock()) {
+            // Writer thread could be terminated while holding the lock
+            return;
+        }
+
+        // Messages are pushed in reverse order
+        LogMessage* list{};
+        for (auto message = pending.exchange(nullptr, std::memory_order_acquire); message;) {
+            auto next = message->next;
+            message->next = list;
+            list = message;
+            message = next;
+        }
+
+        if (!list) {
+            return;
+        }
+
+        while (list) {
+            write(*list);
+
+            auto next = list->next;
+            delete list;
+            list = next;
+        }
+
+        for (auto& file : files) {
+            file.second.flush();
+        }
+    }
+
+private:
+    void run()
+    {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wakeUp.wait_for(lock, flushInterval);
+            }
 
-    const auto path{hooks::gameFolder() / logFile};
+            flush(true);
+        }
+    }
+
+    void write(const LogMessage& message)
+    {
+        auto it = files.find(message.logFile);
+        if (it == files.end()) {
+            const auto path{hooks::gameFolder() / message.logFile};
+
+            it = files.emplace(message.logFile, std::ofstream{}).first;
+            it->second.open(path.c_str(), std::ios_base::app);
+        }
+
+        const std::tm tm = *std::localtime(&message.time);
+        it->second << "[" << std::put_time(&tm, "%c") << "]\t" << message.threadId << "\t"
+                   << message.message << "\n";
+    }
+
+    std::atomic<LogMessage*> pending{};
+    std::once_flag threadStarted;
+    std::mutex wakeMutex;
+    std::condition_variable wakeUp;
+    std::mutex writeMutex;
+    std::unordered_map<std::string, std::ofstream> files;
+};
+
+static Logger& getLogger()
+{
+    // Never destroyed, detached writer thread and late log calls can still access it
+    static Logger* logger = new Logger;
+    return *logger;
+}
 
-    std::ofstream file(path.c_str(), std::ios_base::app);
-    const std::time_t time{std::time(nullptr)};
-    const std::tm tm = *std::localtime(&time);
-    const auto tid = std::this_thread::get_id();
+static void logAction(const std::string& logFile, const std::string& message, bool urgent)
+{
+    auto logMessage = new LogMessage{nullptr, logFile, message, std::time(nullptr),
+                                     std::this_thread::get_id()};
 
-    file << "[" << std::put_time(&tm, "%c") << "]\t" << tid << "\t" << message << "\n";
+    getLogger().push(logMessage, urgent);
 }
 
 void logDebug(const std::string& logFile, const std::string& message)
 {
     if (userSettings().debugMode) {
-        logAction(logFile, message);
+        logAction(logFile, message, false);
     }
 }
 
 void logError(const std::string& logFile, const std::string& message)
 {
-    logAction(logFile, message);
+    logAction(logFile, message, true);
+}
+
+void startLogger()
+{
+    getLogger().start();
+}
+
+void flushLogs()
+{
+    getLogger().flush(false);
 }
 
 } // namespace hooks
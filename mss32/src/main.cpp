@@ -38,6 +38,7 @@
 static HMODULE library{};
 static void* registerInterface{};
 static void* unregisterInterface{};
+static LPTOP_LEVEL_EXCEPTION_FILTER previousExceptionFilter{};
 std::thread::id mainThreadId;
 
 extern "C" __declspec(naked) void __stdcall RIB_register_interface(void)
@@ -194,9 +195,21 @@ static void setupVftableHooks()
     hooks::logDebug("mss32Proxy.log", "All vftable hooks are set");
 }
 
+static LONG WINAPI flushLogsOnCrash(EXCEPTION_POINTERS* exceptionInfo)
+{
+    hooks::flushLogs();
+
+    if (previousExceptionFilter) {
+        return previousExceptionFilter(exceptionInfo);
+    }
+
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
 BOOL APIENTRY DllMain(HMODULE hDll, DWORD reason, LPVOID reserved)
 {
     if (reason == DLL_PROCESS_DETACH) {
+        hooks::flushLogs();
         FreeLibrary(library);
         return TRUE;
     }
@@ -206,6 +219,7 @@ BOOL APIENTRY DllMain(HMODULE hDll, DWORD reason, LPVOID reserved)
     }
 
     mainThreadId = std::this_thread::get_id();
+    previousExceptionFilter = SetUnhandledExceptionFilter(flushLogsOnCrash);
 
     library = LoadLibrary("Mss23.dll");
     if (!library) {
@@ -228,11 +242,13 @@ BOOL APIENTRY DllMain(HMODULE hDll, DWORD reason, LPVOID reserved)
             fmt::format("Failed to determine target exe type.\nReason: {:s}.", error.message())};
 
         hooks::logError("mssProxyError.log", msg);
+        hooks::flushLogs();
         MessageBox(NULL, msg.c_str(), "mss32.dll proxy", MB_OK);
         return FALSE;
     }
 
     if (hooks::executableIsGame() && !hooks::loadUnitsForHire()) {
+        hooks::flushLogs();
         MessageBox(NULL, "Failed to load new units. Check error log for details.",
                    "mss32.dll proxy", MB_OK);
         return FALSE;
@@ -241,6 +257,7 @@ BOOL APIENTRY DllMain(HMODULE hDll, DWORD reason, LPVOID reserved)
     adjustGameRestrictions();
     setupVftableHooks();
     if (!setupHooks()) {
+        hooks::flushLogs();
         return FALSE;
     }
 
@@ -46,9 +46,12 @@
 #include "textboxinterf.h"
 #include "uimanager.h"
 #include "utils.h"
+#include <algorithm>
 #include <chrono>
 #include <fmt/chrono.h>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
 
 namespace hooks {
 
@@ -152,10 +155,28 @@ static void __fastcall menuLogoutAccountBtnHandler(CMenuCustomLobby*, int /*%edx
     logoutAccount();
 }
 
-static void __fastcall menuRoomsListSearchHandler(CMenuCustomLobby*, int /*%edx*/)
+/** Rooms search request is sent again if server did not respond in time. */
+static constexpr std::chrono::seconds roomsSearchTimeout{15};
+
+static void menuSearchRooms(CMenuCustomLobby* menu)
+{
+    const auto now{std::chrono::steady_clock::now()};
+    if (menu->roomsSearchPending && now - menu->roomsSearchTime < roomsSearchTimeout) {
+        // Do not pile up requests while server is busy with previous one
+        logDebug("lobby.log", "Rooms list request is still pending");
+        return;
+    }
+
+    if (trySearchRooms()) {
+        menu->roomsSearchPending = true;
+        menu->roomsSearchTime = now;
+    }
+}
+
+static void __fastcall menuRoomsListSearchHandler(CMenuCustomLobby* thisptr, int /*%edx*/)
 {
     logDebug("lobby.log", "Request fresh rooms list");
-    trySearchRooms();
+    menuSearchRooms(thisptr);
 }
 
 static void __fastcall menuCreateRoomBtnHandler(CMenuCustomLobby* thisptr, int /*%edx*/)
@@ -527,6 +548,8 @@ void menuCustomLobbyCtor(CMenuCustomLobby* menu, game::CMenuPhase* menuPhase)
     menuBase.createMenu(menu, dialogName);
 
     std::vector<RoomInfo>().swap(menu->rooms);
+    menu->roomsSearchTime = {};
+    menu->roomsSearchPending = false;
     menu->loggedIn = false;
 
     const auto freeFunctor = SmartPointerApi::get().createOrFreeNoDtor;
@@ -672,7 +695,7 @@ void customLobbyProcessLogin(CMenuCustomLobby* menu, const char* accountName)
     addRoomsCallback(menu->roomsCallbacks.get());
 
     // Request rooms list as soon as possible, no need to wait for event
-    trySearchRooms();
+    menuSearchRooms(menu);
 
     // Add timer event that will send rooms list requests every 5 seconds
     createTimerEvent(&menu->roomsListEvent, menu, menuRoomsListSearchHandler, 5000);
@@ -705,6 +728,7 @@ void customLobbyProcessLogout(CMenuCustomLobby* menu)
     // Clean up any rooms information to be safe
     listBoxApi.setElementsTotal(listBox, 0);
     menu->rooms.clear();
+    menu->roomsSearchPending = false;
 }
 
 void customLobbySetRoomsInfo(CMenuCustomLobby* menu, std::vector<RoomInfo>&& rooms)
@@ -717,14 +741,80 @@ void customLobbySetRoomsInfo(CMenuCustomLobby* menu, std::vector<RoomInfo>&& roo
     auto listBox = dialogApi.findListBox(dialog, "LBOX_ROOMS");
     auto& listBoxApi = CListBoxInterfApi::get();
 
+    menu->roomsSearchPending = false;
+
     if (!menu->loggedIn) {
         listBoxApi.setElementsTotal(listBox, 0);
         menu->rooms.clear();
         return;
     }
 
-    listBoxApi.setElementsTotal(listBox, (int)rooms.size());
-    menu->rooms = std::move(rooms);
+    std::unordered_map<std::string_view, const RoomInfo*> roomsByName;
+    roomsByName.reserve(rooms.size());
+    for (const auto& room : rooms) {
+        roomsByName.emplace(room.name, &room);
+    }
+
+    auto& cached{menu->rooms};
+    const auto selected{listBoxApi.selectedIndex(listBox)};
+    const auto selectedName{selected >= 0 && selected < (int)cached.size() ? cached[selected].name
+                                                                           : std::string{}};
+    bool changed{};
+
+    // Update known rooms in place, remove the ones that are gone
+    std::vector<RoomInfo> updated;
+    updated.reserve(rooms.size());
+
+    for (auto& room : cached) {
+        auto it = roomsByName.find(room.name);
+        if (it == roomsByName.end() || !it->second) {
+            changed = true;
+            continue;
+        }
+
+        const auto& found{*it->second};
+        if (room.hostName != found.hostName || room.password != found.password
+            || room.totalSlots != found.totalSlots || room.usedSlots != found.usedSlots) {
+            changed = true;
+        }
+
+        updated.push_back(found);
+        // Mark room as known
+        it->second = nullptr;
+    }
+
+    // Add new rooms to the end
+    for (const auto& room : rooms) {
+        auto it = roomsByName.find(room.name);
+        if (it != roomsByName.end() && it->second == &room) {
+            it->second = nullptr;
+            updated.push_back(room);
+            changed = true;
+        }
+    }
+
+    cached = std::move(updated);
+
+    if (!changed) {
+        return;
+    }
+
+    listBoxApi.setElementsTotal(listBox, (int)cached.size());
+
+    // Keep selection on the same room
+    auto it = std::find_if(cached.begin(), cached.end(),
+                           [&selectedName](const RoomInfo& room) {
+                               return room.name == selectedName;
+                           });
+    if (!selectedName.empty() && it != cached.end()) {
+        listBoxApi.setSelectedIndex(listBox, (int)std::distance(cached.begin(), it));
+    }
+}
+
+void customLobbyProcessRoomsSearchError(CMenuCustomLobby* menu, const char* message)
+{
+    menu->roomsSearchPending = false;
+    customLobbyShowError(message);
 }
 
 void customLobbyProcessJoinError(CMenuCustomLobby* menu, const char* message)
@@ -744,6 +834,9 @@ void customLobbyProcessJoinError(CMenuCustomLobby* menu, const char* message)
         buttonJoin->vftable->setEnabled(buttonJoin, true);
     }
 
+    // Room could be gone, refresh the list without waiting for the timer
+    menuSearchRooms(menu);
+
     customLobbyShowError(message);
 }
 
@@ -26,6 +26,7 @@
 #include "midgard.h"
 #include "originalfunctions.h"
 #include "scenariotemplates.h"
+#include "scenvariablesindex.h"
 #include <fmt/format.h>
 
 namespace hooks {
@@ -38,6 +39,8 @@ game::CMenuPhase* __fastcall menuPhaseCtorHooked(game::CMenuPhase* thisptr,
     getOriginalFunctions().menuPhaseCtor(thisptr, a2, a3);
 
     loadScenarioTemplates();
+    // Returned to menus, scenario is unloaded
+    resetScenarioVariablesIndex();
 
     return thisptr;
 }
@@ -45,6 +48,8 @@ game::CMenuPhase* __fastcall menuPhaseCtorHooked(game::CMenuPhase* thisptr,
 void __fastcall menuPhaseDtorHooked(game::CMenuPhase* thisptr, int /*%edx*/, char flags)
 {
     freeScenarioTemplates();
+    // Leaving menus, new scenario is going to be loaded
+    resetScenarioVariablesIndex();
 
     getOriginalFunctions().menuPhaseDtor(thisptr, flags);
 }
@@ -50,11 +50,22 @@ namespace hooks {
 
 static const std::string scriptSignature{"function checkEventCondition(scenario)"};
 
+/** Condition script compiled in a specific lua state. */
+struct CompiledCondition
+{
+    /** Condition code the script was compiled from. */
+    std::string body;
+    std::string code;
+    sol::environment environment;
+    std::optional<sol::protected_function> checkCondition;
+};
+
 /** Custom event condition which logic is controlled entirely by lua script. */
 struct CMidCondScript : public game::CMidEvCondition
 {
     std::string code;
     std::string description;
+    LuaStateObjects<CompiledCondition> compiled;
 };
 
 void __fastcall condScriptDestructor(CMidCondScript* thisptr, int /*%edx*/, char flags)
@@ -63,6 +74,12 @@ void __fastcall condScriptDestructor(CMidCondScript* thisptr, int /*%edx*/, char
     thisptr->code.~basic_string();
     thisptr->description.~basic_string();
 
+    for (auto compiled : thisptr->compiled) {
+        if (compiled) {
+            delete compiled;
+        }
+    }
+
     if (flags & 1) {
         game::Memory::get().freeNonZero(thisptr);
     }
@@ -712,20 +729,31 @@ void __fastcall testScriptDestructor(CTestScript* thisptr, int /*%edx*/, char fl
     }
 }
 
-bool __fastcall testScriptDoTest(const CTestScript* thisptr,
-                                 int /*%edx*/,
-                                 const game::IMidgardObjectMap* objectMap,
-                                 const game::CMidgardID* playerId,
-                                 const game::CMidgardID* eventId)
+/**
+ * Returns condition script compiled in lua state of the calling thread.
+ * Script is compiled once and recompiled only when condition code changes.
+ */
+static const CompiledCondition* getCompiledCondition(CMidCondScript* condition,
+                                                     const game::CMidgardID* eventId)
 {
-    const auto& body = thisptr->condition->code;
-    if (body.empty()) {
-        return false;
+    auto& compiled = condition->compiled[getLuaIndex()];
+
+    const auto& body = condition->code;
+    if (compiled && compiled->body == body) {
+        return compiled->checkCondition ? compiled : nullptr;
     }
 
-    const auto code{fmt::format("{:s}\n{:s}\nend\n", scriptSignature, body)};
+    if (!compiled) {
+        // Condition needs to be compiled in a corresponding thread to use its own Lua instance
+        compiled = new CompiledCondition();
+    }
+
+    compiled->body = body;
+    compiled->code = fmt::format("{:s}\n{:s}\nend\n", scriptSignature, body);
+    compiled->checkCondition = std::nullopt;
+
     sol::protected_function_result result;
-    auto env = executeScript(code, result);
+    compiled->environment = executeScript(compiled->code, result);
     if (!result.valid()) {
         const sol::error err = result;
         logError("mssProxyError.log",
@@ -734,18 +762,35 @@ bool __fastcall testScriptDoTest(const CTestScript* thisptr,
                              "Description: '{:s}'\n"
                              "Script:\n'{:s}'\n"
                              "Reason: '{:s}'",
-                             idToString(eventId), thisptr->condition->description, code,
+                             idToString(eventId), condition->description, compiled->code,
                              err.what()));
+        return nullptr;
+    }
+
+    compiled->checkCondition = getProtectedScriptFunction(compiled->environment,
+                                                          "checkEventCondition", true);
+    // Sanity check, this should never happen
+    return compiled->checkCondition ? compiled : nullptr;
+}
+
+bool __fastcall testScriptDoTest(const CTestScript* thisptr,
+                                 int /*%edx*/,
+                                 const game::IMidgardObjectMap* objectMap,
+                                 const game::CMidgardID* playerId,
+                                 const game::CMidgardID* eventId)
+{
+    if (thisptr->condition->code.empty()) {
         return false;
     }
 
-    auto checkCondition = getProtectedScriptFunction(env, "checkEventCondition", true);
-    if (!checkCondition) { // Sanity check, this should never happen
+    const LuaLease lease;
+    auto compiled = getCompiledCondition(thisptr->condition, eventId);
+    if (!compiled) {
         return false;
     }
 
     const bindings::ScenarioView scenario{objectMap};
-    result = (*checkCondition)(scenario);
+    const sol::protected_function_result result = (*compiled->checkCondition)(scenario);
     if (!result.valid()) {
         const sol::error err = result;
         logError("mssProxyError.log",
@@ -754,8 +799,8 @@ bool __fastcall testScriptDoTest(const CTestScript* thisptr,
                              "Description: '{:s}'\n"
                              "Script:\n'{:s}'\n"
                              "Reason: '{:s}'",
-                             idToString(eventId), thisptr->condition->description, code,
-                             err.what()));
+                             idToString(eventId), thisptr->condition->description,
+                             compiled->code, err.what()));
         return false;
     }
 
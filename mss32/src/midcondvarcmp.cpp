@@ -36,6 +36,7 @@
 #include "midgardstream.h"
 #include "midscenvariables.h"
 #include "radiobuttoninterf.h"
+#include "scenvariablesindex.h"
 #include "testcondition.h"
 #include "textids.h"
 #include "utils.h"
@@ -526,11 +527,20 @@ bool __fastcall testVarCmpDoTest(const CTestVarCmp* thisptr,
         return false;
     }
 
-    const auto& findById = game::CMidScenVariablesApi::get().findById;
+    const auto index = getScenarioVariablesIndex(variables);
     const auto* condition = thisptr->condition;
 
-    const auto value1 = findById(variables, condition->variableId1)->value;
-    const auto value2 = findById(variables, condition->variableId2)->value;
+    const auto getValue = [&index, variables](int variableId) {
+        if (auto variable = index->findById(variableId)) {
+            return variable->second.value;
+        }
+
+        // Let the game handle unknown ids
+        return game::CMidScenVariablesApi::get().findById(variables, variableId)->value;
+    };
+
+    const auto value1 = getValue(condition->variableId1);
+    const auto value2 = getValue(condition->variableId2);
 
     switch (condition->compareType) {
     case CompareType::Equal:
@@ -18,6 +18,8 @@
  */
 
 #include "midserverlogichooks.h"
+#include "custommodifier.h"
+#include "gameutils.h"
 #include "idset.h"
 #include "log.h"
 #include "logutils.h"
@@ -26,6 +28,7 @@
 #include "midserverlogic.h"
 #include "originalfunctions.h"
 #include "refreshinfo.h"
+#include "scenarioinfo.h"
 #include "settings.h"
 #include "unitstovalidate.h"
 #include "unitutils.h"
@@ -83,6 +86,28 @@ void logObjectsToSend(const game::CMidgardScenarioMap* scenarioMap)
     }
 }
 
+void logCustomModifierStatistics(const game::CMidgardScenarioMap* scenarioMap)
+{
+    static int lastTurn{-1};
+
+    auto scenarioInfo = getScenarioInfo(scenarioMap);
+    if (!scenarioInfo || scenarioInfo->currentTurn == lastTurn) {
+        return;
+    }
+
+    auto& statistics = getCustomModifierStatistics();
+    const auto scriptCalls = statistics.scriptCalls.exchange(0);
+    const auto cachedCalls = statistics.cachedCalls.exchange(0);
+
+    if (lastTurn != -1) {
+        logDebug("customModifiers.log",
+                 fmt::format("Turn {:d}, custom modifier script calls: {:d}, cached: {:d}",
+                             lastTurn, scriptCalls, cachedCalls));
+    }
+
+    lastTurn = scenarioInfo->currentTurn;
+}
+
 bool __fastcall midServerLogicSendObjectsChangesHooked(game::IMidMsgSender* thisptr, int /*%edx*/)
 {
     using namespace game;
@@ -98,6 +123,10 @@ bool __fastcall midServerLogicSendObjectsChangesHooked(game::IMidMsgSender* this
         logObjectsToSend(scenarioMap);
     }
 
+    if (userSettings().debugMode) {
+        logCustomModifierStatistics(scenarioMap);
+    }
+
     return getOriginalFunctions().midServerLogicSendObjectsChanges(thisptr);
 }
 
@@ -19,6 +19,7 @@
 
 #include "midunithooks.h"
 #include "campaignstream.h"
+#include "customattackutils.h"
 #include "custommodifier.h"
 #include "custommodifiers.h"
 #include "dynamiccast.h"
@@ -82,6 +83,8 @@ bool __fastcall removeModifierHooked(game::CMidUnit* thisptr,
                 prevModifier->data->next = next;
             }
 
+            increaseBattleVersion();
+
             if (userSettings().modifiers.notifyModifiersChanged) {
                 notifyModifiersChanged(thisptr->unitImpl);
             }
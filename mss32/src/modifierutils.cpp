@@ -21,6 +21,8 @@
 #include "attack.h"
 #include "attackmodified.h"
 #include "battlemsgdata.h"
+#include "battlemsgdatahooks.h"
+#include "customattackutils.h"
 #include "custommodifier.h"
 #include "dynamiccast.h"
 #include "game.h"
@@ -29,11 +31,13 @@
 #include "midgardobjectmap.h"
 #include "midunit.h"
 #include "modifgroup.h"
+#include "occupancymask.h"
 #include "settings.h"
 #include "umattackhooks.h"
 #include "umunit.h"
 #include "unitmodifier.h"
 #include "ussoldier.h"
+#include <algorithm>
 
 namespace hooks {
 
@@ -310,29 +314,52 @@ bool canApplyAnyModifier(game::IAttack* attack,
     return false;
 }
 
-game::ModifiedUnitInfo* getModifiedUnits(game::UnitInfo* unitInfo, game::ModifiedUnitInfo** end)
+/** Calls function for each modified unit entry with valid unit id. */
+template <typename T>
+static void forEachModifiedUnit(game::UnitInfo* unitInfo, T&& function)
 {
     using namespace game;
 
     auto& units = unitInfo->modifiedUnits;
-    if (userSettings().unrestrictedBestowWards) {
-        *end = units.patched + ModifiedUnitCountPatched;
-        return units.patched;
-    } else {
-        *end = units.original + std::size(units.original);
-        return units.original;
+    if (!userSettings().unrestrictedBestowWards) {
+        for (auto& info : units.original) {
+            if (info.unitId != invalidId)
+                function(info);
+        }
+
+        return;
     }
+
+    forEachSetBit(getModifiedUnitsOccupancy(unitInfo),
+                  [&units, &function](unsigned long index) { function(units.patched[index]); });
 }
 
-void resetModifiedUnitsInfo(game::UnitInfo* unitInfo)
+void resetModifiedUnitsInfo(game::BattleMsgData* battleMsgData, game::UnitInfo* unitInfo)
 {
     using namespace game;
 
-    game::ModifiedUnitInfo* end;
-    for (auto info = getModifiedUnits(unitInfo, &end); info < end; info++) {
-        info->unitId = invalidId;
-        info->modifierId = invalidId;
+    if (!userSettings().unrestrictedBestowWards) {
+        for (auto& info : unitInfo->modifiedUnits.original) {
+            info.unitId = invalidId;
+            info.modifierId = invalidId;
+        }
+
+        return;
     }
+
+    // Do not make shared modified units unique if there is nothing to reset
+    const auto mask = getModifiedUnitsOccupancy(unitInfo);
+    if (!mask)
+        return;
+
+    makeModifiedUnitsUnique(battleMsgData);
+
+    forEachModifiedUnit(unitInfo, [](ModifiedUnitInfo& info) {
+        info.unitId = invalidId;
+        info.modifierId = invalidId;
+    });
+
+    getModifiedUnitsOccupancy(unitInfo) = 0;
 }
 
 bool addUnitModifierInfo(game::BattleMsgData* battleMsgData,
@@ -363,18 +390,38 @@ bool addModifiedUnitInfo(const game::CMidgardID* unitId,
     const auto& battle = BattleMsgDataApi::get();
     auto unitInfo = battle.getUnitInfoById(battleMsgData, unitId);
 
-    game::ModifiedUnitInfo* end;
-    for (auto info = getModifiedUnits(unitInfo, &end); info < end; info++) {
-        if (info->unitId == invalidId) {
-            if (!addUnitModifierInfo(battleMsgData, targetUnit, modifierId))
-                return false;
-            info->unitId = targetUnit->id;
-            info->modifierId = *modifierId;
-            return true;
+    if (!userSettings().unrestrictedBestowWards) {
+        for (auto& info : unitInfo->modifiedUnits.original) {
+            if (info.unitId == invalidId) {
+                if (!addUnitModifierInfo(battleMsgData, targetUnit, modifierId))
+                    return false;
+
+                info.unitId = targetUnit->id;
+                info.modifierId = *modifierId;
+                return true;
+            }
         }
+
+        return false;
     }
 
-    return false;
+    const auto index = findFreeSlot(getModifiedUnitsOccupancy(unitInfo),
+                                    ModifiedUnitCountPatched);
+    if (index == ModifiedUnitCountPatched)
+        return false;
+
+    if (!addUnitModifierInfo(battleMsgData, targetUnit, modifierId))
+        return false;
+
+    // Block can be reallocated, get modified units and mask after it
+    makeModifiedUnitsUnique(battleMsgData);
+
+    auto& info = unitInfo->modifiedUnits.patched[index];
+    info.unitId = targetUnit->id;
+    info.modifierId = *modifierId;
+
+    getModifiedUnitsOccupancy(unitInfo) |= std::uint64_t{1} << index;
+    return true;
 }
 
 bool applyModifier(const game::CMidgardID* unitId,
@@ -435,9 +482,9 @@ void removeModifiers(game::BattleMsgData* battleMsgData,
     auto modifiedUnit = static_cast<CMidUnit*>(
         objectMap->vftable->findScenarioObjectByIdForChange(objectMap, modifiedUnitId));
 
-    auto unitModifierIds = getUnitModifierIds(unitInfo, modifiedUnitId);
-    for (auto it = unitModifierIds.begin(); it != unitModifierIds.end(); it++)
-        removeModifier(battleMsgData, modifiedUnit, &(*it));
+    const auto unitModifierIds = getUnitModifierIds(unitInfo, modifiedUnitId);
+    for (const auto& modifierId : unitModifierIds)
+        removeModifier(battleMsgData, modifiedUnit, &modifierId);
 }
 
 game::CMidgardID validateId(game::CMidgardID src)
@@ -450,33 +497,37 @@ game::CMidgardID validateId(game::CMidgardID src)
     return value;
 }
 
-std::set<game::CMidgardID> getModifiedUnitIds(game::UnitInfo* unitInfo)
+void ModifiedUnitIds::addUnique(const game::CMidgardID& id)
 {
-    using namespace game;
+    // Different raw ids can validate to the same value, compare validated ones
+    const auto value = validateId(id);
+    if (std::find(begin(), end(), value) != end())
+        return;
 
-    std::set<CMidgardID> result;
+    ids[count++] = value;
+}
 
-    game::ModifiedUnitInfo* end;
-    for (auto info = getModifiedUnits(unitInfo, &end); info < end; info++) {
-        if (info->unitId != invalidId)
-            result.insert(validateId(info->unitId));
-    }
+ModifiedUnitIds getModifiedUnitIds(game::UnitInfo* unitInfo)
+{
+    using namespace game;
+
+    ModifiedUnitIds result;
+    forEachModifiedUnit(unitInfo,
+                        [&result](const ModifiedUnitInfo& info) { result.addUnique(info.unitId); });
 
     return result;
 }
 
-std::set<game::CMidgardID> getUnitModifierIds(game::UnitInfo* unitInfo,
-                                              const game::CMidgardID* modifiedUnitId)
+ModifiedUnitIds getUnitModifierIds(game::UnitInfo* unitInfo,
+                                   const game::CMidgardID* modifiedUnitId)
 {
     using namespace game;
 
-    std::set<CMidgardID> result;
-
-    game::ModifiedUnitInfo* end;
-    for (auto info = getModifiedUnits(unitInfo, &end); info < end; info++) {
-        if (info->unitId == *modifiedUnitId)
-            result.insert(validateId(info->modifierId));
-    }
+    ModifiedUnitIds result;
+    forEachModifiedUnit(unitInfo, [&result, modifiedUnitId](const ModifiedUnitInfo& info) {
+        if (info.unitId == *modifiedUnitId)
+            result.addUnique(info.modifierId);
+    });
 
     return result;
 }
@@ -679,6 +730,7 @@ bool addModifier(game::CMidUnit* unit, const game::CMidgardID* modifierId, bool
         customModifier->setUnit(unit);
 
     unit->unitImpl = castUmModifierToUnit(modifier);
+    increaseBattleVersion();
 
     if (userSettings().modifiers.notifyModifiersChanged) {
         notifyModifiersChanged(unit->unitImpl);
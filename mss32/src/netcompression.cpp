@@ -0,0 +1,89 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "netcompression.h"
+#include "datacompression.h"
+#include "netcustomplayer.h"
+#include "netmsg.h"
+#include "netstatistics.h"
+#include <BitStream.h>
+#include <RakPeerInterface.h>
+#include <cstring>
+
+namespace hooks {
+
+std::uint32_t sendGameMessage(SLNet::RakPeerInterface* peer,
+                              const game::NetMessageHeader* message,
+                              const SLNet::AddressOrGUID& target,
+                              bool broadcast,
+                              bool compress)
+{
+    const auto data{reinterpret_cast<const unsigned char*>(message)};
+
+    if (compress && message->length >= netCompressionThreshold) {
+        // Compression is done in thread that sends messages, buffer is reused
+        thread_local std::vector<unsigned char> compressed;
+
+        if (compressData(data, message->length, compressed)) {
+            SLNet::BitStream stream;
+            stream.Write(static_cast<unsigned char>(ID_PLAYER_COMPRESSED_MESSAGE));
+            // Write raw bytes, BitStream swaps byte order of integers
+            stream.Write(reinterpret_cast<const char*>(&message->length),
+                         sizeof(message->length));
+            stream.Write(reinterpret_cast<const char*>(compressed.data()),
+                         static_cast<unsigned int>(compressed.size()));
+
+            netStatisticsMessageSent(message, stream.GetNumberOfBytesUsed());
+            return peer->Send(&stream, PacketPriority::HIGH_PRIORITY,
+                              PacketReliability::RELIABLE_ORDERED, 0, target, broadcast);
+        }
+    }
+
+    netStatisticsMessageSent(message, message->length);
+
+    SLNet::BitStream stream(const_cast<unsigned char*>(data), message->length, false);
+    return peer->Send(&stream, PacketPriority::HIGH_PRIORITY, PacketReliability::RELIABLE_ORDERED,
+                      0, target, broadcast);
+}
+
+const game::NetMessageHeader* decompressGameMessage(const SLNet::Packet* packet,
+                                                    std::vector<unsigned char>& buffer)
+{
+    constexpr std::uint32_t headerSize{1 + sizeof(std::uint32_t)};
+    if (packet->length < headerSize) {
+        return nullptr;
+    }
+
+    std::uint32_t length{};
+    std::memcpy(&length, packet->data + 1, sizeof(length));
+
+    if (length < sizeof(game::NetMessageHeader) || length >= game::netMessageMaxLength) {
+        return nullptr;
+    }
+
+    buffer.resize(length);
+    if (!decompressData(packet->data + headerSize, packet->length - headerSize, buffer.data(),
+                        length)) {
+        return nullptr;
+    }
+
+    return reinterpret_cast<const game::NetMessageHeader*>(buffer.data());
+}
+
+} // namespace hooks
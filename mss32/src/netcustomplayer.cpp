@@ -26,12 +26,91 @@
 #include "mqnetsystem.h"
 #include "netcustomsession.h"
 #include "netmsg.h"
+#include <algorithm>
 #include <fmt/format.h>
+#include <map>
 #include <mutex>
 #include <string>
 
 namespace hooks {
 
+void sendPlayerFeatures(SLNet::RakPeerInterface* peer, const SLNet::AddressOrGUID& target)
+{
+    const unsigned char packet[] = {ID_PLAYER_FEATURES,
+                                    PlayerFeatures::Compression | PlayerFeatures::Batching
+                                        | PlayerFeatures::CompactModifiedUnits};
+
+    peer->Send(reinterpret_cast<const char*>(packet), static_cast<int>(std::size(packet)),
+               PacketPriority::HIGH_PRIORITY, PacketReliability::RELIABLE_ORDERED, 0, target,
+               false);
+}
+
+std::uint8_t readPlayerFeatures(const SLNet::Packet* packet)
+{
+    return packet->length > 1 ? packet->data[1] : 0;
+}
+
+using RemotePlayerKey = std::pair<const void*, std::uint32_t>;
+
+static std::mutex remotePlayersMutex;
+static std::map<RemotePlayerKey, std::uint8_t> remotePlayersFeatures;
+
+void setRemotePlayerFeatures(const void* localPlayer, std::uint32_t netId, std::uint8_t features)
+{
+    std::lock_guard<std::mutex> lock(remotePlayersMutex);
+    remotePlayersFeatures[RemotePlayerKey{localPlayer, netId}] = features;
+}
+
+void addRemotePlayer(const void* localPlayer, std::uint32_t netId)
+{
+    std::lock_guard<std::mutex> lock(remotePlayersMutex);
+    remotePlayersFeatures.emplace(RemotePlayerKey{localPlayer, netId}, 0);
+}
+
+void removeRemotePlayer(const void* localPlayer, std::uint32_t netId)
+{
+    std::lock_guard<std::mutex> lock(remotePlayersMutex);
+    remotePlayersFeatures.erase(RemotePlayerKey{localPlayer, netId});
+}
+
+void removeRemotePlayers(const void* localPlayer)
+{
+    std::lock_guard<std::mutex> lock(remotePlayersMutex);
+
+    auto it = remotePlayersFeatures.lower_bound(RemotePlayerKey{localPlayer, 0});
+    while (it != remotePlayersFeatures.end() && it->first.first == localPlayer) {
+        it = remotePlayersFeatures.erase(it);
+    }
+}
+
+bool remotePlayersSupport(std::uint8_t features)
+{
+    std::lock_guard<std::mutex> lock(remotePlayersMutex);
+
+    // Single player, hotseat and DirectPlay sessions have no custom remote players
+    if (remotePlayersFeatures.empty()) {
+        return false;
+    }
+
+    return std::all_of(remotePlayersFeatures.begin(), remotePlayersFeatures.end(),
+                       [features](const auto& remote) {
+                           return (remote.second & features) == features;
+                       });
+}
+
+SLNet::ConnectionAttemptResult connectToPlayerServer(SLNet::RakPeerInterface* peer,
+                                                     const SLNet::SystemAddress& address)
+{
+    // Connection request is resent until server responds,
+    // so connection time depends on actual round trip time and packet loss
+    static constexpr unsigned int connectionAttempts{20};
+    static constexpr unsigned int timeBetweenAttemptsMs{250};
+    static constexpr SLNet::TimeMS connectionTimeoutMs{10000};
+
+    return peer->Connect(address.ToString(false), address.GetPort(), nullptr, 0, nullptr, 0,
+                         connectionAttempts, timeBetweenAttemptsMs, connectionTimeoutMs);
+}
+
 void playerLog(const std::string& message)
 {
     static std::mutex logMutex;
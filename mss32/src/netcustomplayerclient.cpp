@@ -22,23 +22,49 @@
 #include "mempool.h"
 #include "mqnetreception.h"
 #include "mqnetsystem.h"
+#include "netcompression.h"
 #include "netcustomplayer.h"
 #include "netcustomservice.h"
 #include "netcustomsession.h"
 #include "netmessages.h"
 #include "netmsg.h"
+#include "netstatistics.h"
 #include "settings.h"
 #include "utils.h"
-#include <BitStream.h>
 #include <MessageIdentifiers.h>
-#include <chrono>
 #include <fmt/format.h>
-#include <mutex>
-#include <thread>
 
 namespace hooks {
 
-static std::mutex netMessagesMutex;
+static void receiveGameMessage(CNetCustomPlayerClient* playerClient,
+                               SLNet::RakPeerInterface* peer,
+                               const SLNet::Packet* packet,
+                               const game::NetMessageHeader* message,
+                               std::uint32_t length,
+                               std::uint32_t wireLength)
+{
+    auto guid = peer->GetGuidFromSystemAddress(packet->systemAddress);
+    auto guidInt = SLNet::RakNetGUID::ToUint32(guid);
+
+    logDebug("playerClient.log",
+             fmt::format("Game message '{:s}' from {:x}", message->messageClassName, guidInt));
+
+    if (!isNetMessageLengthValid(message, length)) {
+        logDebug("playerClient.log", "Game message has invalid length");
+        return;
+    }
+
+    // Game messages carry no send time, half of round trip time estimates transport latency
+    const auto ping{peer->GetLastPing(packet->systemAddress)};
+    netStatisticsMessageReceived(message, wireLength, ping > 0 ? ping * 1000u / 2u : 0u);
+
+    playerClient->messages.push(std::uint32_t{guidInt}, message);
+
+    auto reception = playerClient->player.netReception;
+    if (reception) {
+        reception->vftable->notify(reception);
+    }
+}
 
 void PlayerClientCallbacks::onPacketReceived(DefaultMessageIDTypes type,
                                              SLNet::RakPeerInterface* peer,
@@ -59,10 +85,13 @@ void PlayerClientCallbacks::onPacketReceived(DefaultMessageIDTypes type,
     case ID_CONNECTION_REQUEST_ACCEPTED: {
         logDebug("playerClient.log", "Connection request to the server was accepted");
 
-        if (netSystem) {
-            auto guid = peer->GetGuidFromSystemAddress(packet->systemAddress);
-            auto guidInt = SLNet::RakNetGUID::ToUint32(guid);
+        auto guidInt = SLNet::RakNetGUID::ToUint32(packet->guid);
+        if (packet->systemAddress == playerClient->serverAddress) {
+            // Server netId is known only when connection is established
+            playerClient->serverId = guidInt;
+        }
 
+        if (netSystem) {
             netSystem->vftable->onPlayerConnected(netSystem, (int)guidInt);
         }
 
@@ -92,32 +121,43 @@ void PlayerClientCallbacks::onPacketReceived(DefaultMessageIDTypes type,
 
         break;
     }
-    case 0xff: {
-        // Game message received
-        auto message = reinterpret_cast<const game::NetMessageHeader*>(packet->data);
-
-        auto guid = peer->GetGuidFromSystemAddress(packet->systemAddress);
-        auto guidInt = SLNet::RakNetGUID::ToUint32(guid);
+    case ID_PLAYER_FEATURES: {
+        const auto features{readPlayerFeatures(packet)};
+        logDebug("playerClient.log", fmt::format("Server features 0x{:x}", features));
 
-        logDebug("playerClient.log",
-                 fmt::format("Game message '{:s}' from {:x}", message->messageClassName, guidInt));
-
-        auto msg = std::make_unique<unsigned char[]>(message->length);
-        std::memcpy(msg.get(), message, message->length);
+        playerClient->serverFeatures = features;
+        setRemotePlayerFeatures(playerClient, 0, features);
+        break;
+    }
+    case ID_PLAYER_COMPRESSED_MESSAGE: {
+        auto message = decompressGameMessage(packet, playerClient->decompressedMessage);
+        if (!message) {
+            logDebug("playerClient.log", "Could not decompress game message");
+            break;
+        }
 
-        {
-            std::lock_guard<std::mutex> messageGuard(netMessagesMutex);
-            playerClient->messages.push_back(
-                CNetCustomPlayerClient::IdMessagePair{std::uint32_t{guidInt}, std::move(msg)});
+        receiveGameMessage(playerClient, peer, packet, message, message->length, packet->length);
+        break;
+    }
+    case ID_PLAYER_BATCHED_MESSAGES: {
+        std::uint32_t offset{1};
+        while (auto message = readBatchedMessage(packet, offset)) {
+            receiveGameMessage(playerClient, peer, packet, message, message->length,
+                               message->length);
         }
 
-        auto reception = playerClient->player.netReception;
-        if (reception) {
-            reception->vftable->notify(reception);
+        if (offset != packet->length) {
+            logDebug("playerClient.log", "Batched game messages are malformed");
         }
 
         break;
     }
+    case 0xff: {
+        // Game message received
+        auto message = reinterpret_cast<const game::NetMessageHeader*>(packet->data);
+        receiveGameMessage(playerClient, peer, packet, message, packet->length, packet->length);
+        break;
+    }
     default:
         logDebug("playerClient.log", fmt::format("Packet type {:d}", static_cast<int>(type)));
         break;
@@ -128,6 +168,7 @@ void __fastcall playerClientDtor(CNetCustomPlayerClient* thisptr, int /*%edx*/,
 {
     playerLog("CNetCustomPlayerClient d-tor");
 
+    removeRemotePlayers(thisptr);
     thisptr->~CNetCustomPlayerClient();
 
     if (flags & 1) {
@@ -162,8 +203,6 @@ int __fastcall playerClientGetMessageCount(CNetCustomPlayerClient* thisptr, int
 {
     playerLog("CNetCustomPlayerClient getMessageCount");
 
-    std::lock_guard<std::mutex> messageGuard(netMessagesMutex);
-
     return static_cast<int>(thisptr->messages.size());
 }
 
@@ -192,11 +231,7 @@ bool __fastcall playerClientSendMessage(CNetCustomPlayerClient* thisptr,
         return false;
     }
 
-    SLNet::BitStream stream((unsigned char*)message, message->length, false);
-
-    if (peer->Send(&stream, PacketPriority::HIGH_PRIORITY, PacketReliability::RELIABLE_ORDERED, 0,
-                   thisptr->serverAddress, false)
-        == 0) {
+    if (!thisptr->batcher.send(message, thisptr->serverAddress, false, thisptr->serverFeatures)) {
         playerLog(fmt::format("CNetCustomPlayerClient {:s} Send returned bad input",
                               thisptr->player.name));
     }
@@ -216,14 +251,13 @@ int __fastcall playerClientReceiveMessage(CNetCustomPlayerClient* thisptr,
 
     playerLog("CNetCustomPlayerClient receiveMessage");
 
-    std::lock_guard<std::mutex> messageGuard(netMessagesMutex);
-
-    if (thisptr->messages.empty()) {
+    std::uint32_t id{};
+    std::uint32_t pushTime{};
+    auto message = thisptr->messages.front(id, &pushTime);
+    if (!message) {
         return 0;
     }
 
-    const auto& pair = thisptr->messages.front();
-    const auto& id{pair.first};
     if (id != thisptr->serverId) {
         playerLog(
             fmt::format("CNetCustomPlayerClient received message from {:x}, its not a server!",
@@ -231,25 +265,20 @@ int __fastcall playerClientReceiveMessage(CNetCustomPlayerClient* thisptr,
         return 0;
     }
 
-    auto message = reinterpret_cast<const game::NetMessageHeader*>(pair.second.get());
-
     if (message->messageType != game::netMessageNormalType) {
         playerLog("CNetCustomPlayerClient received message with invalid type");
         return 3;
     }
 
-    if (message->length >= game::netMessageMaxLength) {
-        playerLog("CNetCustomPlayerClient received message with invalid length");
-        return 3;
-    }
-
     playerLog(fmt::format("CNetCustomPlayerClient receiveMessage '{:s}' length {:d} from 0x{:x}",
-                          message->messageClassName, message->length, pair.first));
+                          message->messageClassName, message->length, id));
+
+    netStatisticsMessageDequeued(message, netTimestamp() - pushTime);
 
     *idFrom = static_cast<int>(id);
     std::memcpy(buffer, message, message->length);
 
-    thisptr->messages.pop_front();
+    thisptr->messages.pop();
     return 2;
 }
 
@@ -307,10 +336,12 @@ CNetCustomPlayerClient::CNetCustomPlayerClient(CNetCustomSession* session,
                                                std::uint32_t serverId)
     : player{session, netSystem, netReception, name, std::move(peer), netId}
     , callbacks(this)
+    , batcher{&player.netPeer}
     , serverAddress{serverAddress}
     , serverId{serverId}
 {
     vftable = &playerClientVftable;
+    addRemotePlayer(this, 0);
 }
 
 void CNetCustomPlayerClient::setupPacketCallbacks()
@@ -371,50 +402,28 @@ game::IMqNetPlayerClient* createCustomPlayerClient(CNetCustomSession* session,
     auto service = session->service;
     auto serverAddress{lobbyAddressToServerPlayer(service->lobbyPeer.peer->GetMyBoundAddress())};
 
-    auto serverIp{serverAddress.ToString(false)};
-    playerLog(fmt::format("Client tries to connect to server at '{:s}'", serverIp));
+    playerLog(fmt::format("Client tries to connect to server at '{:s}'", serverAddress.ToString()));
 
-    // connect to server
-    const auto connectResult{peer->Connect(serverIp, CNetCustomPlayer::serverPort, nullptr, 0)};
+    // Connect to server, server netId is set when connection is accepted
+    const auto connectResult{connectToPlayerServer(peer.get(), serverAddress)};
     if (connectResult != SLNet::ConnectionAttemptResult::CONNECTION_ATTEMPT_STARTED) {
         playerLog(fmt::format("Failed to start CNetCustomPlayerClient connection. Error: {:d}",
                               (int)connectResult));
         return nullptr;
     }
 
-    {
-        playerLog("Wait for fucks sake");
-        using namespace std::chrono_literals;
-        // This delay is needed for SLNet peer to connect to server
-        // so the peer->GetGuidFromSystemAddress() call will work and give us server netId.
-        // This is ugly and unreliable at all.
-        // We can just store server SystemAddress and convert it go guid
-        // or compare with packet->systemAddress to filter messages from server.
-
-        // Or we just assume that players in game never send messages between each other
-        // only to and from the server?
-        std::this_thread::sleep_for(100ms);
-    }
-
     auto netId = SLNet::RakNetGUID::ToUint32(peer->GetMyGUID());
 
     playerLog(fmt::format("Creating player client on port {:d}", clientPort));
 
-    auto serverGuid = peer->GetGuidFromSystemAddress(
-        SLNet::SystemAddress(serverIp, CNetCustomPlayer::serverPort));
-    auto serverId = SLNet::RakNetGUID::ToUint32(serverGuid);
-
     playerLog("Creating CNetCustomPlayerClient");
     auto client = (CNetCustomPlayerClient*)Memory::get().allocate(sizeof(CNetCustomPlayerClient));
     new (client) CNetCustomPlayerClient(session, netSystem, netReception, name, std::move(peer),
-                                        netId, serverAddress, serverId);
-
-    playerLog("Player client created");
+                                        netId, serverAddress, 0);
 
-    playerLog(fmt::format("CNetCustomPlayerClient has netId 0x{:x}, "
-                          "expects server with netId 0x{:x}",
-                          netId, serverId));
+    client->setupPacketCallbacks();
 
+    playerLog(fmt::format("Player client created with netId 0x{:x}", netId));
     return client;
 }
 
@@ -438,12 +447,11 @@ CNetCustomPlayerClient* createCustomHostPlayerClient(CNetCustomSession* session,
     // since host player client is on the same machine as player server
     auto serverAddress{lobbyAddressToServerPlayer(service->lobbyPeer.peer->GetMyBoundAddress())};
 
-    auto serverIp{serverAddress.ToString(false)};
-    playerLog(fmt::format("Host client tries to connect to server at '{:s}', port {:d}", serverIp,
-                          CNetCustomPlayer::serverPort));
+    playerLog(fmt::format("Host client tries to connect to server at '{:s}'",
+                          serverAddress.ToString()));
 
     // Connect to server
-    const auto connectResult{peer->Connect(serverIp, CNetCustomPlayer::serverPort, nullptr, 0)};
+    const auto connectResult{connectToPlayerServer(peer.get(), serverAddress)};
     if (connectResult != SLNet::ConnectionAttemptResult::CONNECTION_ATTEMPT_STARTED) {
         playerLog(fmt::format("Failed to start CNetCustomPlayerClient connection. Error: {:d}",
                               (int)connectResult));
@@ -22,11 +22,12 @@
 #include "mempool.h"
 #include "mqnetreception.h"
 #include "mqnetsystem.h"
+#include "netcompression.h"
 #include "netcustomplayer.h"
 #include "netcustomsession.h"
 #include "netmsg.h"
+#include "netstatistics.h"
 #include "utils.h"
-#include <BitStream.h>
 #include <MessageIdentifiers.h>
 #include <algorithm>
 #include <fmt/format.h>
@@ -34,7 +35,35 @@
 
 namespace hooks {
 
-static std::mutex netMessagesMutex;
+static void receiveGameMessage(CNetCustomPlayerServer* playerServer,
+                               SLNet::RakPeerInterface* peer,
+                               const SLNet::Packet* packet,
+                               const game::NetMessageHeader* message,
+                               std::uint32_t length,
+                               std::uint32_t wireLength)
+{
+    auto guid = peer->GetGuidFromSystemAddress(packet->systemAddress);
+    auto guidInt = SLNet::RakNetGUID::ToUint32(guid);
+
+    /*logDebug("playerServer.log", fmt::format("Game message '{:s}' from {:x}",
+                                             message->messageClassName, guidInt));*/
+
+    if (!isNetMessageLengthValid(message, length)) {
+        logDebug("lobby.log", "PlayerServer: Game message has invalid length");
+        return;
+    }
+
+    // Game messages carry no send time, half of round trip time estimates transport latency
+    const auto ping{peer->GetLastPing(packet->systemAddress)};
+    netStatisticsMessageReceived(message, wireLength, ping > 0 ? ping * 1000u / 2u : 0u);
+
+    playerServer->messages.push(std::uint32_t{guidInt}, message);
+
+    auto reception = playerServer->player.netReception;
+    if (reception) {
+        reception->vftable->notify(reception);
+    }
+}
 
 void PlayerServerCallbacks::onPacketReceived(DefaultMessageIDTypes type,
                                              SLNet::RakPeerInterface* peer,
@@ -59,9 +88,7 @@ void PlayerServerCallbacks::onPacketReceived(DefaultMessageIDTypes type,
         logDebug("lobby.log", "PlayerServer: Client lost connection");
 
         auto guid = peer->GetGuidFromSystemAddress(packet->systemAddress);
-
-        auto& ids = playerServer->connectedIds;
-        ids.erase(std::remove(ids.begin(), ids.end(), guid), ids.end());
+        playerServer->removeClient(guid);
 
         if (netSystem) {
             auto guidInt = SLNet::RakNetGUID::ToUint32(guid);
@@ -74,8 +101,9 @@ void PlayerServerCallbacks::onPacketReceived(DefaultMessageIDTypes type,
         logDebug("lobby.log", "PlayerServer: Client connected");
         break;
     case ID_CONNECTION_REQUEST_ACCEPTED:
-        // This should never happen on server ?
+        // Player server connects only to lobby server
         logDebug("lobby.log", "PlayerServer: Connection request to the server was accepted");
+        playerServer->lobbyServerGuid = packet->guid;
         break;
     case ID_NEW_INCOMING_CONNECTION: {
         auto guid = peer->GetGuidFromSystemAddress(packet->systemAddress);
@@ -83,7 +111,7 @@ void PlayerServerCallbacks::onPacketReceived(DefaultMessageIDTypes type,
 
         logDebug("lobby.log", fmt::format("PlayerServer: Incoming connection, id 0x{:x}", guidInt));
 
-        playerServer->connectedIds.push_back(guid);
+        playerServer->addClient(guid);
 
         if (netSystem) {
             logDebug("lobby.log", "PlayerServer: Call netSystem onPlayerConnected");
@@ -102,6 +130,8 @@ void PlayerServerCallbacks::onPacketReceived(DefaultMessageIDTypes type,
     case ID_DISCONNECTION_NOTIFICATION: {
         logDebug("lobby.log", "PlayerServer: Client has disconnected from server");
 
+        playerServer->removeClient(packet->guid);
+
         if (netSystem) {
             auto guid = peer->GetGuidFromSystemAddress(packet->systemAddress);
             auto guidInt = SLNet::RakNetGUID::ToUint32(guid);
@@ -114,6 +144,8 @@ void PlayerServerCallbacks::onPacketReceived(DefaultMessageIDTypes type,
     case ID_CONNECTION_LOST: {
         logDebug("lobby.log", "PlayerServer: Client has lost connection");
 
+        playerServer->removeClient(packet->guid);
+
         if (netSystem) {
             auto guid = peer->GetGuidFromSystemAddress(packet->systemAddress);
             auto guidInt = SLNet::RakNetGUID::ToUint32(guid);
@@ -123,35 +155,44 @@ void PlayerServerCallbacks::onPacketReceived(DefaultMessageIDTypes type,
 
         break;
     }
-    case 0xff: {
-        // Game message received
-        auto message = reinterpret_cast<const game::NetMessageHeader*>(packet->data);
+    case ID_PLAYER_FEATURES: {
+        const auto features{readPlayerFeatures(packet)};
+        logDebug("lobby.log", fmt::format("PlayerServer: Client features 0x{:x}", features));
 
-        auto guid = peer->GetGuidFromSystemAddress(packet->systemAddress);
-        auto guidInt = SLNet::RakNetGUID::ToUint32(guid);
-
-        /*logDebug("playerServer.log", fmt::format("Game message '{:s}' from {:x}",
-                                                 message->messageClassName, guidInt));*/
-
-        // logDebug("playerServer.log", "Allocate net message");
-
-        auto msg = std::make_unique<unsigned char[]>(message->length);
-        // logDebug("playerServer.log", "Copy net message");
-        std::memcpy(msg.get(), message, message->length);
+        playerServer->setClientFeatures(packet->guid, features);
+        // Respond with our own features
+        sendPlayerFeatures(peer, packet->guid);
+        break;
+    }
+    case ID_PLAYER_COMPRESSED_MESSAGE: {
+        auto message = decompressGameMessage(packet, playerServer->decompressedMessage);
+        if (!message) {
+            logDebug("lobby.log", "PlayerServer: Could not decompress game message");
+            break;
+        }
 
-        {
-            std::lock_guard<std::mutex> messageGuard(netMessagesMutex);
-            playerServer->messages.push_back(
-                CNetCustomPlayerServer::IdMessagePair{std::uint32_t{guidInt}, std::move(msg)});
+        receiveGameMessage(playerServer, peer, packet, message, message->length, packet->length);
+        break;
+    }
+    case ID_PLAYER_BATCHED_MESSAGES: {
+        std::uint32_t offset{1};
+        while (auto message = readBatchedMessage(packet, offset)) {
+            receiveGameMessage(playerServer, peer, packet, message, message->length,
+                               message->length);
         }
 
-        auto reception = playerServer->player.netReception;
-        if (reception) {
-            reception->vftable->notify(reception);
+        if (offset != packet->length) {
+            logDebug("lobby.log", "PlayerServer: Batched game messages are malformed");
         }
 
         break;
     }
+    case 0xff: {
+        // Game message received
+        auto message = reinterpret_cast<const game::NetMessageHeader*>(packet->data);
+        receiveGameMessage(playerServer, peer, packet, message, packet->length, packet->length);
+        break;
+    }
     default:
         logDebug("lobby.log",
                  fmt::format("PlayerServer: Packet type {:d}", static_cast<int>(packet->data[0])));
@@ -163,6 +204,7 @@ static void __fastcall playerServerDtor(CNetCustomPlayerServer* thisptr, int /*%
 {
     playerLog("CNetCustomPlayerServer d-tor");
 
+    removeRemotePlayers(thisptr);
     thisptr->~CNetCustomPlayerServer();
 
     if (flags & 1) {
@@ -197,8 +239,6 @@ static int __fastcall playerServerGetMessageCount(CNetCustomPlayerServer* thispt
 {
     playerLog("CNetCustomPlayerServer getMessageCount");
 
-    std::lock_guard<std::mutex> messageGuard(netMessagesMutex);
-
     return static_cast<int>(thisptr->messages.size());
 }
 
@@ -214,33 +254,48 @@ static bool __fastcall playerServerSendMessage(CNetCustomPlayerServer* thisptr,
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(thisptr->clientsMutex);
+
     const auto& connectedIds{thisptr->connectedIds};
-    SLNet::BitStream stream((unsigned char*)message, message->length, false);
 
     if (idTo == game::broadcastNetPlayerId) {
         playerLog("CNetCustomPlayerServer sendMessage broadcast");
 
-        // Do not use broadcast Send() because player server is also connected to lobby server
-        // and we do not want to send him game messages
+        // Player server is also connected to lobby server and we do not want to send him
+        // game messages. Use single broadcast Send() excluding lobby server
+        // when there are no other connections besides clients
+        unsigned short connections{};
+        peer->GetConnectionList(nullptr, &connections);
+
+        if (thisptr->lobbyServerGuid != SLNet::UNASSIGNED_RAKNET_GUID
+            && connections == connectedIds.size() + 1) {
+            // Use only features every client supports
+            std::uint8_t features{0xff};
+            for (const auto& guid : connectedIds) {
+                features &= thisptr->getClientFeatures(SLNet::RakNetGUID::ToUint32(guid));
+            }
+
+            thisptr->batcher.send(message, thisptr->lobbyServerGuid, true, features);
+            return true;
+        }
+
         for (const auto& guid : connectedIds) {
-            peer->Send(&stream, PacketPriority::HIGH_PRIORITY, PacketReliability::RELIABLE_ORDERED,
-                       0, guid, false);
+            const auto features{thisptr->getClientFeatures(SLNet::RakNetGUID::ToUint32(guid))};
+            thisptr->batcher.send(message, guid, false, features);
         }
 
         return true;
     }
 
-    auto it = std::find_if(connectedIds.begin(), connectedIds.end(), [idTo](const auto& guid) {
-        return static_cast<int>(SLNet::RakNetGUID::ToUint32(guid)) == idTo;
-    });
+    const auto& clients{thisptr->clientsByNetId};
+    auto it = clients.find(static_cast<std::uint32_t>(idTo));
 
-    if (it != connectedIds.end()) {
-        const auto& guid = *it;
+    if (it != clients.end()) {
+        const auto& guid = it->second;
         playerLog(fmt::format("CNetCustomPlayerServer sendMessage to 0x{:x}",
                               std::uint32_t{SLNet::RakNetGUID::ToUint32(guid)}));
 
-        peer->Send(&stream, PacketPriority::HIGH_PRIORITY, PacketReliability::RELIABLE_ORDERED, 0,
-                   guid, false);
+        thisptr->batcher.send(message, guid, false, thisptr->getClientFeatures(it->first));
         return true;
     }
 
@@ -261,32 +316,27 @@ static int __fastcall playerServerReceiveMessage(CNetCustomPlayerServer* thisptr
 
     playerLog("CNetCustomPlayerServer receiveMessage");
 
-    std::lock_guard<std::mutex> messageGuard(netMessagesMutex);
-
-    if (thisptr->messages.empty()) {
+    std::uint32_t id{};
+    std::uint32_t pushTime{};
+    auto message = thisptr->messages.front(id, &pushTime);
+    if (!message) {
         return 0;
     }
 
-    const auto& pair = thisptr->messages.front();
-    auto message = reinterpret_cast<const game::NetMessageHeader*>(pair.second.get());
-
     if (message->messageType != game::netMessageNormalType) {
         playerLog("CNetCustomPlayerServer received message with invalid type");
         return 3;
     }
 
-    if (message->length >= game::netMessageMaxLength) {
-        playerLog("CNetCustomPlayerServer received message with invalid length");
-        return 3;
-    }
-
     playerLog(fmt::format("CNetCustomPlayerServer receiveMessage '{:s}' length {:d} from 0x{:x}",
-                          message->messageClassName, message->length, pair.first));
+                          message->messageClassName, message->length, id));
+
+    netStatisticsMessageDequeued(message, netTimestamp() - pushTime);
 
-    *idFrom = static_cast<int>(pair.first);
+    *idFrom = static_cast<int>(id);
     std::memcpy(buffer, message, message->length);
 
-    thisptr->messages.pop_front();
+    thisptr->messages.pop();
     return 2;
 }
 
@@ -351,6 +401,7 @@ CNetCustomPlayerServer::CNetCustomPlayerServer(CNetCustomSession* session,
     // 1 is a server netId hardcoded in game and was also used in DirectPlay.
     : player{session, netSystem, netReception, "SERVER", std::move(peer), 1}
     , callbacks{this}
+    , batcher{&player.netPeer}
 {
     vftable = &playerServerVftable;
     player.netPeer.addCallback(&callbacks);
@@ -363,18 +414,61 @@ bool CNetCustomPlayerServer::notifyHostClientConnected()
         return false;
     }
 
-    if (connectedIds.empty()) {
-        playerLog("PlayerServer: host client is not connected");
-        return false;
+    std::uint32_t hostClientNetId{};
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        if (connectedIds.empty()) {
+            playerLog("PlayerServer: host client is not connected");
+            return false;
+        }
+
+        hostClientNetId = SLNet::RakNetGUID::ToUint32(connectedIds[0]);
     }
 
-    const std::uint32_t hostClientNetId{SLNet::RakNetGUID::ToUint32(connectedIds[0])};
     playerLog(fmt::format("PlayerServer: onPlayerConnected 0x{:x}", hostClientNetId));
 
     player.netSystem->vftable->onPlayerConnected(player.netSystem, (int)hostClientNetId);
     return true;
 }
 
+void CNetCustomPlayerServer::addClient(const SLNet::RakNetGUID& guid)
+{
+    std::lock_guard<std::mutex> lock(clientsMutex);
+
+    if (std::find(connectedIds.begin(), connectedIds.end(), guid) == connectedIds.end()) {
+        connectedIds.push_back(guid);
+    }
+
+    clientsByNetId[SLNet::RakNetGUID::ToUint32(guid)] = guid;
+    addRemotePlayer(this, SLNet::RakNetGUID::ToUint32(guid));
+}
+
+void CNetCustomPlayerServer::removeClient(const SLNet::RakNetGUID& guid)
+{
+    std::lock_guard<std::mutex> lock(clientsMutex);
+
+    connectedIds.erase(std::remove(connectedIds.begin(), connectedIds.end(), guid),
+                       connectedIds.end());
+    clientsByNetId.erase(SLNet::RakNetGUID::ToUint32(guid));
+    clientFeatures.erase(SLNet::RakNetGUID::ToUint32(guid));
+    removeRemotePlayer(this, SLNet::RakNetGUID::ToUint32(guid));
+}
+
+void CNetCustomPlayerServer::setClientFeatures(const SLNet::RakNetGUID& guid,
+                                               std::uint8_t features)
+{
+    std::lock_guard<std::mutex> lock(clientsMutex);
+
+    clientFeatures[SLNet::RakNetGUID::ToUint32(guid)] = features;
+    setRemotePlayerFeatures(this, SLNet::RakNetGUID::ToUint32(guid), features);
+}
+
+std::uint8_t CNetCustomPlayerServer::getClientFeatures(std::uint32_t netId) const
+{
+    auto it = clientFeatures.find(netId);
+    return it != clientFeatures.end() ? it->second : 0;
+}
+
 game::IMqNetPlayerServer* createCustomPlayerServer(CNetCustomSession* session,
                                                    game::IMqNetSystem* netSystem,
                                                    game::IMqNetReception* netReception)
@@ -24,6 +24,7 @@
 #include "midgard.h"
 #include "mqnetservice.h"
 #include "netcustomsession.h"
+#include "netstatistics.h"
 #include "settings.h"
 #include "utils.h"
 #include <MessageIdentifiers.h>
@@ -112,6 +113,8 @@ void __fastcall netCustomServiceDtor(CNetCustomService* thisptr, int /*%edx*/, c
 {
     logDebug("lobby.log", "CNetCustomService d-tor called");
     thisptr->~CNetCustomService();
+    // Network session is over, keep the last values
+    netStatisticsDump();
 
     if (flags & 1) {
         logDebug("lobby.log", "CNetCustomService d-tor frees memory");
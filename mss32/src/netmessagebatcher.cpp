@@ -0,0 +1,186 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "netmessagebatcher.h"
+#include "netcompression.h"
+#include "netcustomplayer.h"
+#include "netmessagequeue.h"
+#include "netmsg.h"
+#include "netstatistics.h"
+#include "networkpeer.h"
+#include "utils.h"
+#include <RakPeerInterface.h>
+#include <algorithm>
+#include <fmt/format.h>
+
+namespace hooks {
+
+static bool isSameTarget(const SLNet::AddressOrGUID& first, const SLNet::AddressOrGUID& second)
+{
+    return first.rakNetGuid == second.rakNetGuid && first.systemAddress == second.systemAddress;
+}
+
+/** Returns true if messages sent to both targets can reach the same player. */
+static bool haveSameRecipients(const SLNet::AddressOrGUID& first,
+                               bool firstBroadcast,
+                               const SLNet::AddressOrGUID& second,
+                               bool secondBroadcast)
+{
+    return firstBroadcast || secondBroadcast || isSameTarget(first, second);
+}
+
+void __fastcall flushEventCallback(NetMessageBatcher* batcher,
+                                   int /*%edx*/,
+                                   unsigned int /*wParam*/,
+                                   long /*lParam*/)
+{
+    batcher->flush();
+}
+
+NetMessageBatcher::NetMessageBatcher(NetworkPeer* netPeer)
+    : netPeer{netPeer}
+    , peer{netPeer->peer.get()}
+{
+    flushMessageId = createMessageEvent(&flushEvent, this, flushEventCallback,
+                                        "MssProxyNetMessageBatcherFlush");
+}
+
+NetMessageBatcher::~NetMessageBatcher()
+{
+    flush();
+    game::UiEventApi::get().destructor(&flushEvent);
+}
+
+bool NetMessageBatcher::send(const game::NetMessageHeader* message,
+                             const SLNet::AddressOrGUID& target,
+                             bool broadcast,
+                             std::uint8_t features)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const bool compress{(features & PlayerFeatures::Compression) != 0};
+    if (!(features & PlayerFeatures::Batching) || message->length >= netBatchMaxLength) {
+        // Messages sent earlier should arrive first
+        flushBatches();
+        return sendGameMessage(peer, message, target, broadcast, compress) != 0;
+    }
+
+    auto it = std::find_if(batches.begin(), batches.end(), [&](const Batch& batch) {
+        return batch.broadcast == broadcast && isSameTarget(batch.target, target);
+    });
+
+    if (it != batches.end()) {
+        // Appending to the batch would reorder the message with messages
+        // for the same recipients that were batched after it
+        const bool reordered{std::any_of(it + 1, batches.end(), [&](const Batch& batch) {
+            return haveSameRecipients(batch.target, batch.broadcast, target, broadcast);
+        })};
+
+        if (reordered || it->data.size() + message->length > netBatchMaxLength) {
+            flushBatches();
+            it = batches.end();
+        }
+    }
+
+    if (it == batches.end()) {
+        Batch batch;
+        batch.data.reserve(netBatchMaxLength);
+        batch.data.push_back(static_cast<unsigned char>(ID_PLAYER_BATCHED_MESSAGES));
+        batch.target = target;
+        batch.broadcast = broadcast;
+
+        batches.push_back(std::move(batch));
+        it = batches.end() - 1;
+
+        if (!flushPending) {
+            // Send batches when the game returns to its message loop
+            flushPending = netPeer->postMessage(flushMessageId);
+        }
+    }
+
+    const auto data{reinterpret_cast<const unsigned char*>(message)};
+    it->data.insert(it->data.end(), data, data + message->length);
+    ++it->messages;
+
+    if (!flushPending) {
+        // Flush event was not posted, nothing would send the batches later
+        return flushBatches();
+    }
+
+    return true;
+}
+
+void NetMessageBatcher::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    flushPending = false;
+    flushBatches();
+}
+
+bool NetMessageBatcher::flushBatches()
+{
+    bool result{true};
+    for (auto& batch : batches) {
+        result &= flushBatch(batch);
+    }
+
+    batches.clear();
+    return result;
+}
+
+bool NetMessageBatcher::flushBatch(Batch& batch)
+{
+    if (!batch.messages) {
+        return true;
+    }
+
+    std::uint32_t result{};
+    if (batch.messages == 1) {
+        // Single message does not need a batch
+        auto message{reinterpret_cast<const game::NetMessageHeader*>(&batch.data[1])};
+        result = sendGameMessage(peer, message, batch.target, batch.broadcast, false);
+    } else {
+        for (std::size_t offset = 1; offset < batch.data.size();) {
+            auto message{reinterpret_cast<const game::NetMessageHeader*>(&batch.data[offset])};
+            netStatisticsMessageSent(message, message->length);
+            offset += message->length;
+        }
+
+        result = peer->Send(reinterpret_cast<const char*>(batch.data.data()),
+                            static_cast<int>(batch.data.size()), PacketPriority::HIGH_PRIORITY,
+                            PacketReliability::RELIABLE_ORDERED, 0, batch.target,
+                            batch.broadcast);
+    }
+
+    if (!result) {
+        playerLog(fmt::format("Failed to send batch of {:d} messages, {:d} bytes", batch.messages,
+                              batch.data.size()));
+    }
+
+    return result != 0;
+}
+
+const game::NetMessageHeader* readBatchedMessage(const SLNet::Packet* packet,
+                                                 std::uint32_t& offset)
+{
+    return readBatchedMessage(packet->data, packet->length, offset);
+}
+
+} // namespace hooks
@@ -0,0 +1,209 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "netmessagequeue.h"
+#include "netmessageheader.h"
+#include "netstatistics.h"
+#include <cstring>
+
+namespace hooks {
+
+/** Ring buffer fits any message, even when it should wrap around. */
+static constexpr std::uint32_t ringCapacity{2 * game::netMessageMaxLength};
+/** Record header always fits in the space left before the end of the ring buffer. */
+static constexpr std::uint32_t recordAlignment{16};
+/** Marks unused space at the end of the ring buffer. */
+static constexpr std::uint32_t paddingLength{0xffffffff};
+
+static_assert((ringCapacity & (ringCapacity - 1)) == 0,
+              "Ring buffer capacity should be a power of two");
+
+static std::uint32_t alignRecord(std::uint32_t size)
+{
+    return (size + recordAlignment - 1) & ~(recordAlignment - 1);
+}
+
+bool isNetMessageLengthValid(const game::NetMessageHeader* message, std::uint32_t packetLength)
+{
+    if (packetLength < sizeof(game::NetMessageHeader)) {
+        return false;
+    }
+
+    return message->length >= sizeof(game::NetMessageHeader)
+           && message->length < game::netMessageMaxLength && message->length <= packetLength;
+}
+
+const game::NetMessageHeader* readBatchedMessage(const unsigned char* data,
+                                                 std::uint32_t length,
+                                                 std::uint32_t& offset)
+{
+    if (offset >= length) {
+        return nullptr;
+    }
+
+    const auto message{reinterpret_cast<const game::NetMessageHeader*>(data + offset)};
+    if (!isNetMessageLengthValid(message, length - offset)) {
+        return nullptr;
+    }
+
+    offset += message->length;
+    return message;
+}
+
+NetMessageQueue::NetMessageQueue()
+    : ring{std::make_unique<unsigned char[]>(ringCapacity)}
+{ }
+
+void NetMessageQueue::push(std::uint32_t idFrom, const game::NetMessageHeader* message)
+{
+    const auto pushTime{netTimestamp()};
+
+    // Only producer sets the flag, when it is not set messages go to the ring buffer
+    if (!overflowed.load(std::memory_order_acquire) && pushToRing(idFrom, message, pushTime)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(overflowMutex);
+
+    // Consumer could drain overflow list while we were waiting
+    if (overflow.empty() && pushToRing(idFrom, message, pushTime)) {
+        overflowed.store(false, std::memory_order_release);
+        return;
+    }
+
+    const auto data = reinterpret_cast<const unsigned char*>(message);
+    overflow.push_back({idFrom, pushTime, {data, data + message->length}});
+    overflowed.store(true, std::memory_order_release);
+    pushed.fetch_add(1, std::memory_order_release);
+}
+
+bool NetMessageQueue::pushToRing(std::uint32_t idFrom,
+                                 const game::NetMessageHeader* message,
+                                 std::uint32_t pushTime)
+{
+    const auto writePos = head.load(std::memory_order_relaxed);
+    const auto readPos = tail.load(std::memory_order_acquire);
+    const auto freeSpace = ringCapacity - (writePos - readPos);
+
+    const auto offset = writePos & (ringCapacity - 1);
+    static_assert(sizeof(Record) == recordAlignment,
+                  "Record header should take exactly one alignment unit");
+
+    const auto recordSize = alignRecord(sizeof(Record) + message->length);
+    const auto spaceToEnd = ringCapacity - offset;
+    const auto padding = recordSize > spaceToEnd ? spaceToEnd : 0u;
+
+    if (freeSpace < recordSize + padding) {
+        return false;
+    }
+
+    auto position = writePos;
+    if (padding) {
+        const Record record{0, paddingLength, 0, 0};
+        std::memcpy(&ring[offset], &record, sizeof(record));
+        position += padding;
+    }
+
+    const Record record{idFrom, message->length, pushTime, 0};
+    const auto recordOffset = position & (ringCapacity - 1);
+    std::memcpy(&ring[recordOffset], &record, sizeof(record));
+    std::memcpy(&ring[recordOffset + sizeof(record)], message, message->length);
+
+    head.store(position + recordSize, std::memory_order_release);
+    pushed.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+const game::NetMessageHeader* NetMessageQueue::front(std::uint32_t& idFrom,
+                                                     std::uint32_t* pushTime)
+{
+    auto readPos = tail.load(std::memory_order_relaxed);
+    const auto writePos = head.load(std::memory_order_acquire);
+
+    if (readPos != writePos) {
+        auto offset = readPos & (ringCapacity - 1);
+        auto record = reinterpret_cast<const Record*>(&ring[offset]);
+
+        if (record->length == paddingLength) {
+            // Skip unused space, next record is at the beginning
+            readPos += ringCapacity - offset;
+            tail.store(readPos, std::memory_order_release);
+
+            record = reinterpret_cast<const Record*>(&ring[0]);
+        }
+
+        idFrom = record->idFrom;
+        if (pushTime) {
+            *pushTime = record->pushTime;
+        }
+
+        frontFromOverflow = false;
+        return reinterpret_cast<const game::NetMessageHeader*>(record + 1);
+    }
+
+    if (!overflowed.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+
+    // Ring buffer is empty, messages pushed after it are waiting in overflow list
+    std::lock_guard<std::mutex> lock(overflowMutex);
+    if (overflow.empty()) {
+        return nullptr;
+    }
+
+    const auto& message = overflow.front();
+    idFrom = message.idFrom;
+    if (pushTime) {
+        *pushTime = message.pushTime;
+    }
+
+    frontFromOverflow = true;
+    return reinterpret_cast<const game::NetMessageHeader*>(message.data.data());
+}
+
+void NetMessageQueue::pop()
+{
+    std::uint32_t idFrom{};
+    const auto message = front(idFrom);
+    if (!message) {
+        return;
+    }
+
+    if (frontFromOverflow) {
+        std::lock_guard<std::mutex> lock(overflowMutex);
+        overflow.pop_front();
+        if (overflow.empty()) {
+            overflowed.store(false, std::memory_order_release);
+        }
+    } else {
+        const auto recordSize = alignRecord(sizeof(Record) + message->length);
+        tail.store(tail.load(std::memory_order_relaxed) + recordSize, std::memory_order_release);
+    }
+
+    popped.fetch_add(1, std::memory_order_release);
+}
+
+std::uint32_t NetMessageQueue::size() const
+{
+    // Read popped count first so it never exceeds pushed one
+    const auto poppedCount = popped.load(std::memory_order_acquire);
+    return pushed.load(std::memory_order_acquire) - poppedCount;
+}
+
+} // namespace hooks
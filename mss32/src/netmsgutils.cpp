@@ -19,11 +19,128 @@
 
 #include "netmsgutils.h"
 #include "battlemsgdata.h"
+#include "battlemsgdatahooks.h"
+#include "customattackutils.h"
+#include "log.h"
 #include "mqstream.h"
+#include "netcustomplayer.h"
+#include <cstdint>
+#include <cstring>
+#include <fmt/format.h>
 #include <vector>
 
 namespace hooks {
 
+/**
+ * Marks compact format of modified units: count-prefixed list of non-empty entries.
+ * Id category bits are set to invalid, so the value never matches first entry of raw array
+ * that older versions send: it is either invalidId or an id of scenario unit.
+ * Written only when all remote players announced PlayerFeatures::CompactModifiedUnits.
+ */
+static constexpr std::uint32_t modifiedUnitsFormatV1{0xfffe0001};
+
+static void writeModifiedUnits(game::BattleMsgData* battleMsgData, game::CMqStream* stream)
+{
+    using namespace game;
+
+    auto serialize = stream->vftable->serialize;
+
+    if (!remotePlayersSupport(PlayerFeatures::CompactModifiedUnits)) {
+        // Some of the players run older version that only reads raw arrays
+        for (auto& unitInfo : battleMsgData->unitsInfo) {
+            serialize(stream, unitInfo.modifiedUnits.patched,
+                      static_cast<int>(sizeof(ModifiedUnitInfo) * ModifiedUnitCountPatched));
+        }
+
+        return;
+    }
+
+    serialize(stream, &modifiedUnitsFormatV1, sizeof(modifiedUnitsFormatV1));
+
+    for (auto& unitInfo : battleMsgData->unitsInfo) {
+        const auto modifiedUnits = unitInfo.modifiedUnits.patched;
+
+        std::uint8_t count{};
+        for (size_t i = 0; i < ModifiedUnitCountPatched; i++) {
+            if (modifiedUnits[i].unitId != invalidId) {
+                ++count;
+            }
+        }
+
+        serialize(stream, &count, sizeof(count));
+
+        for (std::uint8_t i = 0; i < ModifiedUnitCountPatched && count; i++) {
+            if (modifiedUnits[i].unitId != invalidId) {
+                serialize(stream, &i, sizeof(i));
+                serialize(stream, &modifiedUnits[i], sizeof(ModifiedUnitInfo));
+                --count;
+            }
+        }
+    }
+}
+
+static void readModifiedUnits(game::BattleMsgData* battleMsgData, game::CMqStream* stream)
+{
+    using namespace game;
+
+    auto serialize = stream->vftable->serialize;
+
+    std::uint32_t format{};
+    serialize(stream, &format, sizeof(format));
+
+    makeModifiedUnitsUnique(battleMsgData);
+
+    if (format != modifiedUnitsFormatV1) {
+        // Message from older version, read raw arrays.
+        // Format value that was already read is the first entry of the first array
+        bool first = true;
+        for (auto& unitInfo : battleMsgData->unitsInfo) {
+            auto data = reinterpret_cast<char*>(unitInfo.modifiedUnits.patched);
+            auto size = sizeof(ModifiedUnitInfo) * ModifiedUnitCountPatched;
+            if (first) {
+                std::memcpy(data, &format, sizeof(format));
+                data += sizeof(format);
+                size -= sizeof(format);
+                first = false;
+            }
+
+            serialize(stream, data, static_cast<int>(size));
+            updateModifiedUnitsOccupancy(&unitInfo);
+        }
+
+        return;
+    }
+
+    for (auto& unitInfo : battleMsgData->unitsInfo) {
+        const auto modifiedUnits = unitInfo.modifiedUnits.patched;
+        for (size_t i = 0; i < ModifiedUnitCountPatched; i++) {
+            modifiedUnits[i].unitId = invalidId;
+            modifiedUnits[i].modifierId = invalidId;
+        }
+
+        std::uint8_t count{};
+        serialize(stream, &count, sizeof(count));
+
+        for (std::uint8_t i = 0; i < count; i++) {
+            std::uint8_t index{};
+            ModifiedUnitInfo info{};
+            serialize(stream, &index, sizeof(index));
+            serialize(stream, &info, sizeof(info));
+
+            if (index >= ModifiedUnitCountPatched) {
+                logError("mssProxyError.log",
+                         fmt::format("Battle message contains wrong modified unit index {:d}",
+                                     index));
+                continue;
+            }
+
+            modifiedUnits[index] = info;
+        }
+
+        updateModifiedUnitsOccupancy(&unitInfo);
+    }
+}
+
 void serializeMsgWithBattleMsgData(game::CNetMsg* msg,
                                    game::BattleMsgData* battleMsgData,
                                    game::CNetMsgVftable::Serialize method,
@@ -43,13 +160,12 @@ void serializeMsgWithBattleMsgData(game::CNetMsg* msg,
         for (size_t i = 0; i < count; i++) {
             battleMsgData->unitsInfo[i].modifiedUnits.patched = prev[i];
         }
+
+        readModifiedUnits(battleMsgData, stream);
+        increaseBattleVersion();
     } else {
         method(msg, stream);
-    }
-
-    for (auto& unitInfo : battleMsgData->unitsInfo) {
-        stream->vftable->serialize(stream, unitInfo.modifiedUnits.patched,
-                                   sizeof(ModifiedUnitInfo) * ModifiedUnitCountPatched);
+        writeModifiedUnits(battleMsgData, stream);
     }
 }
 
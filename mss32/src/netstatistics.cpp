@@ -0,0 +1,267 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "netstatistics.h"
+#include "log.h"
+#include "netmsg.h"
+#include "settings.h"
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace hooks {
+
+/** Upper bounds of histogram buckets in microseconds, last bucket is unbounded. */
+static constexpr std::array<std::uint32_t, 10> histogramBounds{
+    250, 1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000};
+/** Statistics file is rewritten with accumulated values at this interval. */
+static constexpr std::chrono::seconds dumpInterval{10};
+
+struct Histogram
+{
+    void add(std::uint32_t value)
+    {
+        const auto bound{
+            std::lower_bound(histogramBounds.begin(), histogramBounds.end(), value)};
+
+        buckets[std::distance(histogramBounds.begin(), bound)]++;
+        total += value;
+        count++;
+    }
+
+    std::uint64_t average() const
+    {
+        return count ? total / count : 0;
+    }
+
+    std::array<std::uint32_t, histogramBounds.size() + 1> buckets{};
+    std::uint64_t total{};
+    std::uint32_t count{};
+};
+
+struct MessageStatistics
+{
+    std::uint32_t sent{};
+    std::uint64_t sentBytes{};
+    std::uint64_t sentWireBytes{};
+    std::uint32_t received{};
+    std::uint64_t receivedBytes{};
+    std::uint64_t receivedWireBytes{};
+    Histogram queueWait;
+    Histogram latency;
+};
+
+using MessageStatisticsMap = std::map<std::string, MessageStatistics, std::less<>>;
+
+class NetStatistics
+{
+public:
+    MessageStatistics& get(const game::NetMessageHeader* message)
+    {
+        const std::string_view name(message->messageClassName,
+                                    strnlen(message->messageClassName,
+                                            sizeof(message->messageClassName)));
+
+        auto it = messages.find(name);
+        if (it == messages.end()) {
+            it = messages.emplace(std::string(name), MessageStatistics{}).first;
+        }
+
+        return it->second;
+    }
+
+    /** Copies accumulated values if it is time to write them, should be called under the lock. */
+    std::optional<MessageStatisticsMap> snapshotIfNeeded()
+    {
+        const auto now{std::chrono::steady_clock::now()};
+        if (now - lastDump < dumpInterval) {
+            return std::nullopt;
+        }
+
+        lastDump = now;
+        return messages;
+    }
+
+    MessageStatisticsMap snapshot() const
+    {
+        return messages;
+    }
+
+    std::mutex mutex;
+    /** Serializes file writes, which are done without holding the statistics lock. */
+    std::mutex fileMutex;
+
+private:
+    MessageStatisticsMap messages;
+    std::chrono::steady_clock::time_point lastDump{std::chrono::steady_clock::now()};
+};
+
+static void writeNetStatistics(NetStatistics* statistics, const MessageStatisticsMap& messages)
+{
+    std::lock_guard<std::mutex> lock(statistics->fileMutex);
+
+    std::ofstream file(gameFolder() / "netStatistics.csv", std::ios_base::trunc);
+    if (!file) {
+        logError("mssProxyError.log", "Could not write network statistics file");
+        return;
+    }
+
+    std::string header{"Message;Sent;Sent bytes;Sent wire bytes;Received;Received bytes;"
+                       "Received wire bytes;Avg queue wait us;Avg latency us"};
+    for (const char* histogram : {"Queue wait", "Latency"}) {
+        for (auto bound : histogramBounds) {
+            header += fmt::format(";{:s} <= {:d} us", histogram, bound);
+        }
+
+        header += fmt::format(";{:s} > {:d} us", histogram, histogramBounds.back());
+    }
+
+    file << header << '\n';
+
+    for (const auto& [name, stats] : messages) {
+        file << fmt::format("{:s};{:d};{:d};{:d};{:d};{:d};{:d};{:d};{:d}", name, stats.sent,
+                            stats.sentBytes, stats.sentWireBytes, stats.received,
+                            stats.receivedBytes, stats.receivedWireBytes,
+                            stats.queueWait.average(), stats.latency.average());
+
+        for (const auto* histogram : {&stats.queueWait, &stats.latency}) {
+            for (auto count : histogram->buckets) {
+                file << ';' << count;
+            }
+        }
+
+        file << '\n';
+    }
+}
+
+static NetStatistics* getNetStatistics()
+{
+    if (!userSettings().debug.netStatistics) {
+        return nullptr;
+    }
+
+    static NetStatistics statistics;
+    return &statistics;
+}
+
+std::uint32_t netTimestamp()
+{
+    using namespace std::chrono;
+
+    const auto now{steady_clock::now().time_since_epoch()};
+    return static_cast<std::uint32_t>(duration_cast<microseconds>(now).count());
+}
+
+void netStatisticsMessageSent(const game::NetMessageHeader* message, std::uint32_t wireLength)
+{
+    auto statistics{getNetStatistics()};
+    if (!statistics) {
+        return;
+    }
+
+    std::optional<MessageStatisticsMap> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(statistics->mutex);
+
+        auto& stats{statistics->get(message)};
+        stats.sent++;
+        stats.sentBytes += message->length;
+        stats.sentWireBytes += wireLength;
+
+        snapshot = statistics->snapshotIfNeeded();
+    }
+
+    if (snapshot) {
+        writeNetStatistics(statistics, *snapshot);
+    }
+}
+
+void netStatisticsMessageReceived(const game::NetMessageHeader* message,
+                                  std::uint32_t wireLength,
+                                  std::uint32_t latency)
+{
+    auto statistics{getNetStatistics()};
+    if (!statistics) {
+        return;
+    }
+
+    std::optional<MessageStatisticsMap> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(statistics->mutex);
+
+        auto& stats{statistics->get(message)};
+        stats.received++;
+        stats.receivedBytes += message->length;
+        stats.receivedWireBytes += wireLength;
+        stats.latency.add(latency);
+
+        snapshot = statistics->snapshotIfNeeded();
+    }
+
+    if (snapshot) {
+        writeNetStatistics(statistics, *snapshot);
+    }
+}
+
+void netStatisticsMessageDequeued(const game::NetMessageHeader* message, std::uint32_t queueWait)
+{
+    auto statistics{getNetStatistics()};
+    if (!statistics) {
+        return;
+    }
+
+    std::optional<MessageStatisticsMap> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(statistics->mutex);
+
+        statistics->get(message).queueWait.add(queueWait);
+        snapshot = statistics->snapshotIfNeeded();
+    }
+
+    if (snapshot) {
+        writeNetStatistics(statistics, *snapshot);
+    }
+}
+
+void netStatisticsDump()
+{
+    auto statistics{getNetStatistics()};
+    if (!statistics) {
+        return;
+    }
+
+    MessageStatisticsMap snapshot;
+    {
+        std::lock_guard<std::mutex> lock(statistics->mutex);
+        snapshot = statistics->snapshot();
+    }
+
+    writeNetStatistics(statistics, snapshot);
+}
+
+} // namespace hooks
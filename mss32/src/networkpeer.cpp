@@ -18,18 +18,77 @@
  */
 
 #include "networkpeer.h"
+#include "mquikernelsimple.h"
+#include "uimanager.h"
 #include "utils.h"
+#include <DS_List.h>
+#include <RakNetSocket2.h>
+#include <Windows.h>
 #include <algorithm>
+#include <mutex>
 
 namespace hooks {
 
-void __fastcall packetEventCallback(NetworkPeer* netPeer, int /*%edx*/)
+/** Packets processing interval in case wakeup message was missed. */
+static constexpr std::uint32_t packetPollIntervalMs{100};
+
+/** Packets polling interval after wakeup that found no packets. */
+static constexpr std::uint32_t wakeupRetryIntervalMs{5};
+static constexpr std::uint32_t wakeupRetriesMax{10};
+
+/** Maps peer sockets to network peers, since datagram handler does not receive user data. */
+static std::mutex peerSocketsMutex;
+static std::vector<std::pair<const SLNet::RakNetSocket2*, NetworkPeer*>> peerSockets;
+
+static bool isAcknowledgement(const SLNet::RNS2RecvStruct* recvStruct)
+{
+    if (recvStruct->bytesRead < 1) {
+        return false;
+    }
+
+    // Connected datagram header starts with 'valid', 'ACK' and 'NAK' bits.
+    // Offline messages start with message id that never has 'valid' bit set
+    const auto header{static_cast<std::uint8_t>(recvStruct->data[0])};
+    return (header & 0x80) && (header & 0x60);
+}
+
+static bool incomingDatagramHandler(SLNet::RNS2RecvStruct* recvStruct)
+{
+    // Called from peer socket thread.
+    // Acknowledgements are consumed by the peer itself and never result in packets
+    if (isAcknowledgement(recvStruct)) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(peerSocketsMutex);
+
+    for (const auto& [socket, netPeer] : peerSockets) {
+        if (socket != recvStruct->socket) {
+            continue;
+        }
+
+        // Wake up ui thread only once until it processes packets
+        if (!netPeer->wakeupPending.exchange(true)
+            && !netPeer->postMessage(netPeer->wakeupMessageId,
+                                     reinterpret_cast<std::uintptr_t>(netPeer))) {
+            netPeer->wakeupPending = false;
+        }
+
+        break;
+    }
+
+    return true;
+}
+
+static bool processPackets(NetworkPeer* netPeer)
 {
     auto peer{netPeer->peer.get()};
+    bool received{};
 
     for (auto packet = peer->Receive(); packet != nullptr;
          peer->DeallocatePacket(packet), packet = peer->Receive()) {
 
+        received = true;
         auto type = static_cast<DefaultMessageIDTypes>(packet->data[0]);
 
         for (auto& callback : netPeer->callbacks) {
@@ -48,19 +107,113 @@ void __fastcall packetEventCallback(NetworkPeer* netPeer, int /*%edx*/)
 
         toRemove.clear();
     }
+
+    return received;
+}
+
+void __fastcall packetEventCallback(NetworkPeer* netPeer, int /*%edx*/)
+{
+    processPackets(netPeer);
+}
+
+static void stopWakeupRetry(NetworkPeer* netPeer)
+{
+    if (netPeer->wakeupRetryActive) {
+        netPeer->wakeupRetryActive = false;
+        game::UiEventApi::get().destructor(&netPeer->wakeupRetryEvent);
+    }
+}
+
+void __fastcall wakeupRetryEventCallback(NetworkPeer* netPeer, int /*%edx*/)
+{
+    if (processPackets(netPeer) || ++netPeer->wakeupRetries >= wakeupRetriesMax) {
+        stopWakeupRetry(netPeer);
+    }
+}
+
+void __fastcall wakeupEventCallback(NetworkPeer* netPeer,
+                                    int /*%edx*/,
+                                    unsigned int wParam,
+                                    long /*lParam*/)
+{
+    // Wakeup message is shared by all peers
+    if (wParam != reinterpret_cast<std::uintptr_t>(netPeer)) {
+        return;
+    }
+
+    netPeer->wakeupPending = false;
+
+    if (processPackets(netPeer)) {
+        return;
+    }
+
+    // Datagram is still being processed by peer update thread, poll until its packet arrives
+    netPeer->wakeupRetries = 0;
+    if (!netPeer->wakeupRetryActive) {
+        netPeer->wakeupRetryActive = true;
+        createTimerEvent(&netPeer->wakeupRetryEvent, netPeer, wakeupRetryEventCallback,
+                         wakeupRetryIntervalMs);
+    }
+}
+
+static HWND getGameWindow()
+{
+    const auto& uiManagerApi = game::CUIManagerApi::get();
+
+    game::UIManagerPtr uiManager;
+    uiManagerApi.get(&uiManager);
+
+    auto uiKernel = uiManager.data->data->uiKernel;
+    const auto window = uiKernel->vftable->getWindowHandle(uiKernel);
+
+    game::SmartPointerApi::get().createOrFree((game::SmartPointer*)&uiManager, nullptr);
+    return window;
 }
 
 NetworkPeer::NetworkPeer(PeerPtr&& peer)
     : peer{std::move(peer)}
+    , gameWindow{getGameWindow()}
 {
-    createTimerEvent(&packetEvent, this, packetEventCallback, 100);
+    createTimerEvent(&packetEvent, this, packetEventCallback, packetPollIntervalMs);
+    wakeupMessageId = createMessageEvent(&wakeupEvent, this, wakeupEventCallback,
+                                         "MssProxyNetworkPeerWakeup");
+
+    if (this->peer) {
+        DataStructures::List<SLNet::RakNetSocket2*> sockets;
+        this->peer->GetSockets(sockets);
+
+        {
+            std::lock_guard<std::mutex> lock(peerSocketsMutex);
+            for (unsigned int i = 0; i < sockets.Size(); ++i) {
+                peerSockets.emplace_back(sockets[i], this);
+            }
+        }
+
+        this->peer->SetIncomingDatagramEventHandler(incomingDatagramHandler);
+    }
 }
 
 NetworkPeer::~NetworkPeer()
 {
+    {
+        std::lock_guard<std::mutex> lock(peerSocketsMutex);
+        peerSockets.erase(std::remove_if(peerSockets.begin(), peerSockets.end(),
+                                         [this](const auto& entry) {
+                                             return entry.second == this;
+                                         }),
+                          peerSockets.end());
+    }
+
+    stopWakeupRetry(this);
+    game::UiEventApi::get().destructor(&wakeupEvent);
     game::UiEventApi::get().destructor(&packetEvent);
 }
 
+bool NetworkPeer::postMessage(std::uint32_t messageId, std::uintptr_t wParam) const
+{
+    return gameWindow && PostMessage(static_cast<HWND>(gameWindow), messageId, wParam, 0);
+}
+
 void NetworkPeer::addCallback(NetworkPeerCallbacks* callback)
 {
     if (std::find(callbacks.begin(), callbacks.end(), callback) == callbacks.end()) {
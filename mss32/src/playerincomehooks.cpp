@@ -33,14 +33,75 @@
 #include "originalfunctions.h"
 #include "racecategory.h"
 #include "racetype.h"
+#include "scenvariablesindex.h"
 #include "settings.h"
 #include "utils.h"
 #include <algorithm>
 #include <array>
 #include <fmt/format.h>
+#include <mutex>
 
 namespace hooks {
 
+/** Capital (tier 0) and village tiers 1-5. */
+static constexpr std::size_t cityTiersTotal{6};
+
+static const std::array<const char*, 5> racePrefixes{"EMPIRE_", "LEGIONS_", "CLANS_", "HORDES_",
+                                                     "ELVES_"};
+
+using CityIncome = std::array<int, cityTiersTotal>;
+/** Scenario can have several variables with the same name, their values are summed. */
+using CityIncomeTiers = std::array<ScenarioVariablesIndex::Variables, cityTiersTotal>;
+
+/** City income variables of a scenario, found once instead of every player turn. */
+struct CityIncomeVariables
+{
+    ScenarioVariablesIndexPtr index;
+    std::array<CityIncomeTiers, racePrefixes.size()> races;
+    CityIncomeTiers allRaces;
+};
+
+static CityIncome getCityIncome(const game::CMidScenVariables* scenVariables,
+                                std::size_t raceIndex)
+{
+    static std::mutex variablesMutex;
+    static CityIncomeVariables variables{};
+
+    std::lock_guard<std::mutex> lock(variablesMutex);
+
+    auto index{getScenarioVariablesIndex(scenVariables)};
+    if (variables.index != index) {
+        for (std::size_t i = 0; i < racePrefixes.size(); ++i) {
+            for (std::size_t tier = 0; tier < cityTiersTotal; ++tier) {
+                const auto name{fmt::format("{:s}TIER_{:d}_CITY_INCOME", racePrefixes[i], tier)};
+                variables.races[i][tier] = index->findAllByName(name);
+            }
+        }
+
+        for (std::size_t tier = 0; tier < cityTiersTotal; ++tier) {
+            const auto name{fmt::format("TIER_{:d}_CITY_INCOME", tier)};
+            variables.allRaces[tier] = index->findAllByName(name);
+        }
+
+        variables.index = std::move(index);
+    }
+
+    CityIncome cityIncome{};
+    for (std::size_t tier = 0; tier < cityTiersTotal; ++tier) {
+        // Additional income for specific race
+        for (auto variable : variables.races[raceIndex][tier]) {
+            cityIncome[tier] += variable->second.value;
+        }
+
+        // Additional income for all races
+        for (auto variable : variables.allRaces[tier]) {
+            cityIncome[tier] += variable->second.value;
+        }
+    }
+
+    return cityIncome;
+}
+
 game::Bank* __stdcall computePlayerDailyIncomeHooked(game::Bank* income,
                                                      game::IMidgardObjectMap* objectMap,
                                                      const game::CMidgardID* playerId)
@@ -91,21 +152,21 @@ game::Bank* __stdcall computePlayerDailyIncomeHooked(game::Bank* income,
     }
 
     const auto raceId = player->raceType->data->raceType.id;
-    const char* racePrefix{};
+    std::size_t raceIndex{racePrefixes.size()};
 
     if (raceId == races.human->id) {
-        racePrefix = "EMPIRE_";
+        raceIndex = 0;
     } else if (raceId == races.heretic->id) {
-        racePrefix = "LEGIONS_";
+        raceIndex = 1;
     } else if (raceId == races.dwarf->id) {
-        racePrefix = "CLANS_";
+        raceIndex = 2;
     } else if (raceId == races.undead->id) {
-        racePrefix = "HORDES_";
+        raceIndex = 3;
     } else if (raceId == races.elf->id) {
-        racePrefix = "ELVES_";
+        raceIndex = 4;
     }
 
-    if (!racePrefix) {
+    if (raceIndex == racePrefixes.size()) {
         logError("mssProxyError.log",
                  fmt::format("Trying to compute daily income for unknown race. "
                              "LRace.dbf id: {:d}",
@@ -113,43 +174,7 @@ game::Bank* __stdcall computePlayerDailyIncomeHooked(game::Bank* income,
         return income;
     }
 
-    std::array<int, 6> cityIncome = {0, 0, 0, 0, 0, 0};
-
-    logDebug("cityIncome.log",
-             fmt::format("Loop through {:d} scenario variables", variables->variables.length));
-
-    std::uint32_t listIndex{};
-    for (const auto& variable : variables->variables) {
-        const auto& name = variable.second.name;
-
-        // Additional income for specific race
-        if (!strncmp(name, racePrefix, std::strlen(racePrefix))) {
-            for (int i = 0; i < 6; ++i) {
-                const auto expectedName{fmt::format("{:s}TIER_{:d}_CITY_INCOME", racePrefix, i)};
-
-                if (!strncmp(name, expectedName.c_str(), sizeof(name))) {
-                    cityIncome[i] += variable.second.value;
-                    break;
-                }
-            }
-        }
-
-        // Additional income for all races
-        if (!strncmp(name, "TIER", 4)) {
-            for (int i = 0; i < 6; ++i) {
-                const auto expectedName{fmt::format("TIER_{:d}_CITY_INCOME", i)};
-
-                if (!strncmp(name, expectedName.c_str(), sizeof(name))) {
-                    cityIncome[i] += variable.second.value;
-                    break;
-                }
-            }
-        }
-
-        listIndex++;
-    }
-
-    logDebug("cityIncome.log", fmt::format("Loop done in {:d} iterations", listIndex));
+    const auto cityIncome{getCityIncome(variables, raceIndex)};
 
     if (std::all_of(std::begin(cityIncome), std::end(cityIncome),
                     [](int value) { return value == 0; })) {
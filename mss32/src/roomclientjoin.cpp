@@ -68,6 +68,11 @@ static void registerClientPlayerAndJoin()
 
     menuPhase->data->maxPlayers = maxPlayers;
 
+    // Announce transport features before version request,
+    // server responds to them before answering the request
+    auto playerClient{netService->session->players[0]};
+    sendPlayerFeatures(playerClient->getPeer(), playerClient->serverAddress);
+
     CMenusReqVersionMsg requestVersion;
     requestVersion.vftable = NetMessagesApi::getMenusReqVersionVftable();
 
@@ -182,8 +187,7 @@ public:
                      fmt::format("NAT punch succeeded! Player server address {:s}, netId 0x{:x}",
                                  playerClient->serverAddress.ToString(), playerClient->serverId));
 
-            auto result{peer->Connect(packet->systemAddress.ToString(false),
-                                      packet->systemAddress.GetPort(), nullptr, 0)};
+            auto result{connectToPlayerServer(peer, packet->systemAddress)};
             if (result != SLNet::CONNECTION_ATTEMPT_STARTED) {
                 const auto msg{fmt::format(
                     "Failed to connect client player to server player after NAT punch.\nResult {:d}",
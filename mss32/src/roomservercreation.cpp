@@ -98,6 +98,10 @@ public:
 
         hostPlayer->setupPacketCallbacks();
 
+        // Announce transport features before any game message is sent,
+        // server answers with its own features
+        sendPlayerFeatures(peer, packet->systemAddress);
+
         logDebug("lobby.log",
                  fmt::format("Host player netId 0x{:x} connected to player server netId 0x{:x}",
                              player.netId, hostPlayer->serverId));
@@ -0,0 +1,94 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scenvariablesindex.h"
+#include <cstring>
+#include <mutex>
+
+namespace hooks {
+
+static std::mutex indexMutex;
+static ScenarioVariablesIndexPtr currentIndex;
+
+const game::ScenarioVariable* ScenarioVariablesIndex::findByName(std::string_view name) const
+{
+    const auto it = byName.find(name);
+    return it != byName.end() ? it->second.back() : nullptr;
+}
+
+const ScenarioVariablesIndex::Variables& ScenarioVariablesIndex::findAllByName(
+    std::string_view name) const
+{
+    static const Variables empty;
+
+    const auto it = byName.find(name);
+    return it != byName.end() ? it->second : empty;
+}
+
+const game::ScenarioVariable* ScenarioVariablesIndex::findById(int id) const
+{
+    const auto it = byId.find(id);
+    return it != byId.end() ? it->second : nullptr;
+}
+
+static ScenarioVariablesIndexPtr createIndex(const game::CMidScenVariables* scenVariables)
+{
+    auto index = std::make_shared<ScenarioVariablesIndex>();
+    index->scenVariables = scenVariables;
+    index->head = scenVariables->variables.head;
+    index->length = scenVariables->variables.length;
+    index->byName.reserve(index->length);
+    index->byId.reserve(index->length);
+
+    for (const auto& variable : scenVariables->variables) {
+        const auto& name = variable.second.name;
+        // Names are stored by view, variables are alive while scenario is loaded
+        const std::string_view nameView{name, strnlen(name, sizeof(name))};
+
+        index->byName[nameView].push_back(&variable);
+        index->byId[variable.first] = &variable;
+    }
+
+    return index;
+}
+
+ScenarioVariablesIndexPtr getScenarioVariablesIndex(const game::CMidScenVariables* scenVariables)
+{
+    if (!scenVariables) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(indexMutex);
+
+    if (!currentIndex || currentIndex->scenVariables != scenVariables
+        || currentIndex->head != scenVariables->variables.head
+        || currentIndex->length != scenVariables->variables.length) {
+        currentIndex = createIndex(scenVariables);
+    }
+
+    return currentIndex;
+}
+
+void resetScenarioVariablesIndex()
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    currentIndex.reset();
+}
+
+} // namespace hooks
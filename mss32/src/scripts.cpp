@@ -49,11 +49,14 @@
 #include "unitview.h"
 #include "unitviewdummy.h"
 #include "utils.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fmt/format.h>
+#include <memory>
 #include <mutex>
-#include <thread>
-
-extern std::thread::id mainThreadId;
 
 namespace hooks {
 
@@ -65,6 +68,54 @@ struct PathHash
     }
 };
 
+/** Script file precompiled to lua bytecode. */
+struct ScriptChunk
+{
+    std::filesystem::file_time_type writeTime;
+    std::uintmax_t fileSize{};
+    std::string bytecode;
+};
+
+using ScriptChunkPtr = std::shared_ptr<const ScriptChunk>;
+
+/** Script file state as of the last check, chunk is null if the file does not exist. */
+struct ScriptFile
+{
+    std::uint32_t generation{};
+    bool exists{};
+    ScriptChunkPtr chunk;
+};
+
+/** Time to wait for a free lua instance before reporting that the thread is stalled. */
+static constexpr std::chrono::milliseconds luaLeaseTimeout{1000};
+
+/** Marks thread that has no lua instance. */
+static constexpr std::size_t noLuaIndex{maxLuaStates};
+
+/** Pool of lua instances, each instance is used by a single thread at a time. */
+struct LuaPool
+{
+    std::array<std::unique_ptr<sol::state>, maxLuaStates> states;
+    std::array<bool, maxLuaStates> leased{};
+    std::mutex mutex;
+    std::condition_variable released;
+};
+
+/** Lua instance leased by a thread and the number of active LuaLease scopes. */
+struct ThreadLuaLease
+{
+    ~ThreadLuaLease()
+    {
+        depth = 0;
+        releaseLua();
+    }
+
+    std::size_t index{noLuaIndex};
+    std::size_t depth{};
+};
+
+static thread_local ThreadLuaLease threadLease;
+
 static void bindApi(sol::state& lua)
 {
     using namespace game;
@@ -304,15 +355,50 @@ static void bindApi(sol::state& lua)
     lua.set_function("log", [](const std::string& message) { logDebug("luaDebug.log", message); });
 }
 
+static LuaPool& getLuaPool()
+{
+    // Never destroyed: objects bound to lua instances may live in static storage
+    // and must not outlive their lua instances when statics are destroyed on exit
+    static LuaPool* pool = new LuaPool;
+
+    return *pool;
+}
+
+std::size_t getLuaIndex()
+{
+    if (threadLease.index != noLuaIndex) {
+        return threadLease.index;
+    }
+
+    auto& pool = getLuaPool();
+    std::unique_lock<std::mutex> lock(pool.mutex);
+
+    // Wait until some other thread returns its instance if all of them are in use.
+    // Instances are never shared between threads, since lua has no thread safety
+    const auto begin = pool.leased.begin();
+    const auto end = pool.leased.end();
+    const auto hasFreeInstance = [begin, end]() { return std::find(begin, end, false) != end; };
+    while (!pool.released.wait_for(lock, luaLeaseTimeout, hasFreeInstance)) {
+        logError("mssProxyError.log",
+                 fmt::format("All {:d} lua instances are in use, thread waits for a free one",
+                             maxLuaStates));
+    }
+
+    const auto it = std::find(begin, end, false);
+    *it = true;
+    threadLease.index = static_cast<std::size_t>(std::distance(begin, it));
+    return threadLease.index;
+}
+
 // https://sol2.readthedocs.io/en/latest/threading.html
 // Lua has no thread safety. sol does not force thread safety bottlenecks anywhere.
 // Treat access and object handling like you were dealing with a raw int reference (int&).
 sol::state& getLua()
 {
-    static std::unique_ptr<sol::state> mainThreadLua;
-    static std::unique_ptr<sol::state> workerThreadLua;
+    const auto index = getLuaIndex();
 
-    auto& lua = std::this_thread::get_id() == mainThreadId ? mainThreadLua : workerThreadLua;
+    // Only the thread that leased the instance accesses it, no need to lock
+    auto& lua = getLuaPool().states[index];
     if (lua == nullptr) {
         lua = std::make_unique<sol::state>();
         lua->open_libraries(sol::lib::base, sol::lib::package, sol::lib::math, sol::lib::table,
@@ -323,20 +409,33 @@ sol::state& getLua()
     return *lua;
 }
 
-const std::string& getSource(const std::filesystem::path& path)
+void releaseLua()
 {
-    static std::unordered_map<std::filesystem::path, std::string, PathHash> sources;
-    static std::mutex sourcesMutex;
+    if (threadLease.index == noLuaIndex || threadLease.depth) {
+        return;
+    }
 
-    const std::lock_guard<std::mutex> lock(sourcesMutex);
+    auto& pool = getLuaPool();
+    {
+        const std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.leased[threadLease.index] = false;
+    }
 
-    auto it = sources.find(path);
-    if (it != sources.end())
-        return it->second;
+    threadLease.index = noLuaIndex;
+    pool.released.notify_one();
+}
 
-    auto& source = sources[path];
-    source = readFile(path);
-    return source;
+LuaLease::LuaLease()
+{
+    ++threadLease.depth;
+    getLuaIndex();
+}
+
+LuaLease::~LuaLease()
+{
+    if (--threadLease.depth == 0) {
+        releaseLua();
+    }
 }
 
 bindings::ScenarioView getScenario()
@@ -363,21 +462,141 @@ sol::environment executeScript(const std::string& source,
     return env;
 }
 
+static int chunkWriter(lua_State*, const void* data, size_t size, void* userData)
+{
+    static_cast<std::string*>(userData)->append(static_cast<const char*>(data), size);
+    return 0;
+}
+
+/** Increased when script files should be checked for changes. */
+static std::atomic<std::uint32_t> scriptFilesGeneration{1};
+
+void reloadScriptFiles()
+{
+    ++scriptFilesGeneration;
+}
+
+/**
+ * Returns script file compiled to lua bytecode.
+ * Bytecode does not depend on lua state, so compiled chunks are shared between threads.
+ * File is checked for changes once after each reloadScriptFiles() call
+ * and recompiled only when its modification time or size changes.
+ * @param[out] exists false if the file does not exist.
+ * @param[out] error reason of read or compilation failure.
+ */
+static ScriptChunkPtr getScriptChunk(const std::filesystem::path& path,
+                                     bool& exists,
+                                     std::string& error)
+{
+    static std::unordered_map<std::filesystem::path, ScriptFile, PathHash> files;
+    static std::mutex filesMutex;
+
+    const auto generation = scriptFilesGeneration.load();
+
+    ScriptChunkPtr cached;
+    {
+        const std::lock_guard<std::mutex> lock(filesMutex);
+
+        auto it = files.find(path);
+        if (it != files.end()) {
+            if (it->second.generation == generation) {
+                exists = it->second.exists;
+                return it->second.chunk;
+            }
+
+            cached = it->second.chunk;
+        }
+    }
+
+    std::error_code existsError;
+    exists = std::filesystem::exists(path, existsError);
+    if (!exists) {
+        const std::lock_guard<std::mutex> lock(filesMutex);
+        files[path] = ScriptFile{generation, false, nullptr};
+        return nullptr;
+    }
+
+    std::error_code timeError;
+    std::error_code sizeError;
+    const auto writeTime = std::filesystem::last_write_time(path, timeError);
+    const auto fileSize = std::filesystem::file_size(path, sizeError);
+    if (timeError || sizeError) {
+        error = fmt::format("Failed to read '{:s}' script file.", path.string());
+        return nullptr;
+    }
+
+    if (cached && cached->writeTime == writeTime && cached->fileSize == fileSize) {
+        const std::lock_guard<std::mutex> lock(filesMutex);
+        files[path] = ScriptFile{generation, true, cached};
+        return cached;
+    }
+
+    const auto source = readFile(path);
+    if (source.empty()) {
+        error = fmt::format("Failed to read '{:s}' script file.", path.string());
+        return nullptr;
+    }
+
+    auto chunk = std::make_shared<ScriptChunk>();
+    chunk->writeTime = writeTime;
+    chunk->fileSize = fileSize;
+
+    lua_State* lua = getLua().lua_state();
+    const auto chunkName{"@" + path.string()};
+    if (luaL_loadbufferx(lua, source.data(), source.size(), chunkName.c_str(), "t") != LUA_OK) {
+        error = fmt::format("Failed to execute script '{:s}'.\n"
+                            "Reason: '{:s}'",
+                            path.string(), lua_tostring(lua, -1));
+        lua_pop(lua, 1);
+        return nullptr;
+    }
+
+    // Keep debug information so errors still report script lines
+    lua_dump(lua, chunkWriter, &chunk->bytecode, 0);
+    lua_pop(lua, 1);
+
+    const std::lock_guard<std::mutex> lock(filesMutex);
+    files[path] = ScriptFile{generation, true, chunk};
+    return chunk;
+}
+
 std::optional<sol::environment> executeScriptFile(const std::filesystem::path& path,
                                                   bool alwaysExists,
                                                   bool bindScenario)
 {
-    if (!alwaysExists && !std::filesystem::exists(path))
+    bool exists{};
+    std::string error;
+    const auto chunk = getScriptChunk(path, exists, error);
+    if (!chunk) {
+        if (exists) {
+            showErrorMessageBox(error);
+        } else if (alwaysExists) {
+            showErrorMessageBox(fmt::format("Failed to read '{:s}' script file.", path.string()));
+        }
+
         return std::nullopt;
+    }
 
-    const auto& source = getSource(path);
-    if (source.empty()) {
-        showErrorMessageBox(fmt::format("Failed to read '{:s}' script file.", path.string()));
+    auto& lua = getLua();
+
+    // Loading precompiled chunk creates a new function each time,
+    // so each environment gets its own instance of the script.
+    const auto chunkName{"@" + path.string()};
+    sol::load_result loaded = lua.load_buffer(chunk->bytecode.data(), chunk->bytecode.size(),
+                                              chunkName, sol::load_mode::binary);
+    if (!loaded.valid()) {
+        const sol::error err = loaded;
+        showErrorMessageBox(fmt::format("Failed to load script '{:s}'.\n"
+                                        "Reason: '{:s}'",
+                                        path.string(), err.what()));
         return std::nullopt;
     }
 
-    sol::protected_function_result result;
-    auto env = executeScript(source, result, bindScenario);
+    sol::protected_function script = loaded;
+    sol::environment env{lua, sol::create, lua.globals()};
+    env.set_on(script);
+
+    const sol::protected_function_result result = script();
     if (!result.valid()) {
         const sol::error err = result;
         showErrorMessageBox(fmt::format("Failed to execute script '{:s}'.\n"
@@ -386,6 +605,10 @@ std::optional<sol::environment> executeScriptFile(const std::filesystem::path& p
         return std::nullopt;
     }
 
+    if (bindScenario) {
+        env["getScenario"] = &getScenario;
+    }
+
     return {std::move(env)};
 }
 
@@ -426,6 +649,24 @@ std::optional<sol::function> getScriptFunction(const std::filesystem::path& path
     return function;
 }
 
+const std::optional<sol::function>& getScriptFunction(
+    OwnedLuaStateObjects<ScriptFunction>& functions,
+    const std::filesystem::path& path,
+    const char* name,
+    bool alwaysExists,
+    bool bindScenario)
+{
+    auto& function = functions[getLuaIndex()];
+    if (function == nullptr) {
+        // Function needs to be loaded in a corresponding thread to use its own Lua instance
+        function = std::make_unique<ScriptFunction>();
+        function->function = getScriptFunction(path, name, function->environment, alwaysExists,
+                                               bindScenario);
+    }
+
+    return function->function;
+}
+
 std::optional<sol::protected_function> getProtectedScriptFunction(
     const sol::environment& environment,
     const char* name,
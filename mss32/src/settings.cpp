@@ -245,6 +245,7 @@ static void readDebugSettings(const sol::table& table, Settings::Debug& value)
                                                    def.sendObjectsChangesTreshold);
     value.logSinglePlayerMessages = readSetting(category.value(), "logSinglePlayerMessages",
                                                 def.logSinglePlayerMessages);
+    value.netStatistics = readSetting(category.value(), "netStatistics", def.netStatistics);
 }
 
 static void readEngineSettings(const sol::table& table, Settings::Engine& value)
@@ -450,6 +451,7 @@ void initializeUserSettings(Settings& value)
 {
     value = defaultSettings();
 
+    const LuaLease lease;
     const auto path{scriptsFolder() / "settings.lua"};
     try {
         const auto env{executeScriptFile(path)};
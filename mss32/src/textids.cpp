@@ -167,6 +167,7 @@ void readInterfTextIds(const sol::table& table, TextIds::Interf& value)
 
 void initialize(TextIds& value)
 {
+    const LuaLease lease;
     const auto path{hooks::scriptsFolder() / "textids.lua"};
     try {
         const auto env{executeScriptFile(path)};
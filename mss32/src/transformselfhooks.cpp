@@ -55,13 +55,11 @@ static int getTransformSelfLevel(const game::CMidUnit* unit,
 {
     using namespace game;
 
-    // The function is only accessed by the server thread - the single instance is enough.
-    static std::optional<sol::environment> env;
-    static std::optional<sol::function> getLevel;
+    // Function is loaded once in each lua instance
+    static OwnedLuaStateObjects<ScriptFunction> functions;
+    const LuaLease lease;
     const auto path{scriptsFolder() / "transformSelf.lua"};
-    if (!env && !getLevel) {
-        getLevel = getScriptFunction(path, "getLevel", env, true, true);
-    }
+    const auto& getLevel = getScriptFunction(functions, path, "getLevel", true, true);
     if (!getLevel) {
         return 0;
     }
@@ -109,9 +107,10 @@ static int getTransformSelfFreeAttackNumber(int attacksDone,
                                             bool hadDoubleAttack,
                                             bool hasDoubleAttack)
 {
-    std::optional<sol::environment> env;
-    auto f = getScriptFunction(scriptsFolder() / "transformSelf.lua", "getFreeAttackNumber", env,
-                               false, true);
+    static OwnedLuaStateObjects<ScriptFunction> functions;
+    const LuaLease lease;
+    const auto& f = getScriptFunction(functions, scriptsFolder() / "transformSelf.lua",
+                                      "getFreeAttackNumber", false, true);
     if (!f)
         return getTransformSelfFreeAttackNumberDefault(attacksDone, attacksRemain, hadDoubleAttack,
                                                        hasDoubleAttack);
@@ -26,26 +26,22 @@
 #include "globaldata.h"
 #include "mempool.h"
 #include "modifgroup.h"
+#include "scripts.h"
 #include "unitmodifier.h"
-#include <thread>
-
-extern std::thread::id mainThreadId;
 
 namespace hooks {
 
 struct TUnitModifierDataPatched : game::TUnitModifierData
 {
     std::string scriptFileName;
-    CustomModifierFunctions* mainThreadFunctions;
-    CustomModifierFunctions* workerThreadFunctions;
+    LuaStateObjects<CustomModifierFunctions> functions;
 };
 
 const CustomModifierFunctions& getCustomModifierFunctions(const game::TUnitModifier* unitModifier)
 {
     auto data = static_cast<TUnitModifierDataPatched*>(unitModifier->data);
 
-    auto& functions = std::this_thread::get_id() == mainThreadId ? data->mainThreadFunctions
-                                                                 : data->workerThreadFunctions;
+    auto& functions = data->functions[getLuaIndex()];
     if (functions == nullptr) {
         // Functions need to be initialized in a corresponding thread to use its own Lua instance
         functions = new CustomModifierFunctions(data->scriptFileName);
@@ -78,8 +74,7 @@ game::TUnitModifier* __fastcall unitModifierCtorHooked(game::TUnitModifier* this
         data->group.vftable = LModifGroupApi::vftable();
         data->modifier = nullptr;
         new (&data->scriptFileName) std::string();
-        data->mainThreadFunctions = nullptr;
-        data->workerThreadFunctions = nullptr;
+        data->functions.fill(nullptr);
     }
     thisptr->data = data;
 
@@ -128,11 +123,10 @@ void __fastcall unitModifierDtorHooked(game::TUnitModifier* thisptr, int /*%edx*
             modifier->vftable->destructor(modifier, true);
 
         data->scriptFileName.~basic_string();
-        if (data->mainThreadFunctions) {
-            delete data->mainThreadFunctions;
-        }
-        if (data->workerThreadFunctions) {
-            delete data->workerThreadFunctions;
+        for (auto functions : data->functions) {
+            if (functions) {
+                delete functions;
+            }
         }
 
         memFree(data);
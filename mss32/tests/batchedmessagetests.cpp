@@ -0,0 +1,163 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "netmessageheader.h"
+#include "netmessagequeue.h"
+#include "testcheck.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace hooks;
+
+/** Packet id byte that precedes batched messages. */
+static constexpr unsigned char batchPacketId{0xfe};
+
+static void appendMessage(std::vector<unsigned char>& batch,
+                          std::uint32_t length,
+                          std::uint32_t headerLength)
+{
+    game::NetMessageHeader header{};
+    header.messageType = game::netMessageNormalType;
+    header.length = headerLength;
+    std::strcpy(header.messageClassName, "TestMessage");
+
+    const auto begin = batch.size();
+    batch.resize(begin + length, static_cast<unsigned char>(length));
+    std::memcpy(&batch[begin], &header, std::min<std::size_t>(sizeof(header), length));
+}
+
+static void appendMessage(std::vector<unsigned char>& batch, std::uint32_t length)
+{
+    appendMessage(batch, length, length);
+}
+
+/** Returns lengths of messages read from the batch, skipping packet id. */
+static std::vector<std::uint32_t> readLengths(const std::vector<unsigned char>& batch)
+{
+    std::vector<std::uint32_t> lengths;
+
+    std::uint32_t offset{1};
+    const auto size = static_cast<std::uint32_t>(batch.size());
+    while (auto message = readBatchedMessage(batch.data(), size, offset)) {
+        lengths.push_back(message->length);
+    }
+
+    return lengths;
+}
+
+static void testReadAllMessages()
+{
+    std::vector<unsigned char> batch{batchPacketId};
+    appendMessage(batch, sizeof(game::NetMessageHeader));
+    appendMessage(batch, 100);
+    appendMessage(batch, 45);
+
+    CHECK((readLengths(batch) == std::vector<std::uint32_t>{44, 100, 45}));
+}
+
+static void testMessageContents()
+{
+    std::vector<unsigned char> batch{batchPacketId};
+    appendMessage(batch, 60);
+    appendMessage(batch, 70);
+
+    std::uint32_t offset{1};
+    const auto size = static_cast<std::uint32_t>(batch.size());
+
+    auto message = readBatchedMessage(batch.data(), size, offset);
+    CHECK(message == reinterpret_cast<const game::NetMessageHeader*>(&batch[1]));
+    CHECK(offset == 61);
+
+    message = readBatchedMessage(batch.data(), size, offset);
+    CHECK(message == reinterpret_cast<const game::NetMessageHeader*>(&batch[61]));
+    CHECK(message && std::strcmp(message->messageClassName, "TestMessage") == 0);
+    CHECK(offset == size);
+
+    // Reading past the end keeps returning nothing
+    CHECK(readBatchedMessage(batch.data(), size, offset) == nullptr);
+    CHECK(offset == size);
+}
+
+static void testEmptyBatch()
+{
+    const std::vector<unsigned char> batch{batchPacketId};
+    CHECK(readLengths(batch).empty());
+}
+
+static void testTruncatedMessage()
+{
+    // Last message claims more bytes than left in the packet
+    std::vector<unsigned char> batch{batchPacketId};
+    appendMessage(batch, 50);
+    appendMessage(batch, 80, 81);
+
+    CHECK((readLengths(batch) == std::vector<std::uint32_t>{50}));
+
+    // Remaining bytes are too short for a header
+    batch = {batchPacketId};
+    appendMessage(batch, 50);
+    batch.resize(batch.size() + sizeof(game::NetMessageHeader) - 1);
+
+    CHECK((readLengths(batch) == std::vector<std::uint32_t>{50}));
+}
+
+static void testInvalidLengths()
+{
+    // Zero length would never advance the offset
+    std::vector<unsigned char> batch{batchPacketId};
+    appendMessage(batch, 50);
+    appendMessage(batch, 50, 0);
+    appendMessage(batch, 50);
+
+    CHECK((readLengths(batch) == std::vector<std::uint32_t>{50}));
+
+    // Length shorter than header
+    batch = {batchPacketId};
+    appendMessage(batch, 50, sizeof(game::NetMessageHeader) - 1);
+    CHECK(readLengths(batch).empty());
+
+    // Length above the game limit
+    batch = {batchPacketId};
+    appendMessage(batch, 50, game::netMessageMaxLength);
+    CHECK(readLengths(batch).empty());
+}
+
+static void testOffsetPastEnd()
+{
+    std::vector<unsigned char> batch{batchPacketId};
+    appendMessage(batch, 50);
+
+    const auto size = static_cast<std::uint32_t>(batch.size());
+    std::uint32_t offset{size + 10};
+    CHECK(readBatchedMessage(batch.data(), size, offset) == nullptr);
+    CHECK(offset == size + 10);
+}
+
+int main()
+{
+    RUN_TEST(testReadAllMessages);
+    RUN_TEST(testMessageContents);
+    RUN_TEST(testEmptyBatch);
+    RUN_TEST(testTruncatedMessage);
+    RUN_TEST(testInvalidLengths);
+    RUN_TEST(testOffsetPastEnd);
+
+    return tests::failedChecks() ? 1 : 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "datacompression.h"
+#include "testcheck.h"
+#include <cstring>
+#include <random>
+#include <string>
+
+using namespace hooks;
+
+static bool roundTrip(const std::vector<unsigned char>& source)
+{
+    std::vector<unsigned char> compressed;
+    if (!compressData(source.data(), static_cast<std::uint32_t>(source.size()), compressed)) {
+        return false;
+    }
+
+    CHECK(compressed.size() < source.size());
+
+    std::vector<unsigned char> result(source.size());
+    CHECK(decompressData(compressed.data(), static_cast<std::uint32_t>(compressed.size()),
+                         result.data(), static_cast<std::uint32_t>(result.size())));
+    CHECK(result == source);
+    return true;
+}
+
+static std::vector<unsigned char> randomData(std::size_t size, unsigned seed)
+{
+    std::mt19937 random{seed};
+    std::vector<unsigned char> data(size);
+    for (auto& value : data) {
+        value = static_cast<unsigned char>(random());
+    }
+
+    return data;
+}
+
+static std::vector<unsigned char> repeatedText(std::size_t size)
+{
+    static const std::string text{"CMidgardID S143UN0001 CMidUnit modifiers hp 120 xp 45; "};
+
+    std::vector<unsigned char> data(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<unsigned char>(text[i % text.size()]);
+    }
+
+    return data;
+}
+
+static void testSmallInputs()
+{
+    std::vector<unsigned char> compressed;
+
+    // Nothing to gain on inputs shorter than match search limit
+    for (std::uint32_t size = 0; size <= 16; ++size) {
+        const std::vector<unsigned char> data(size, 'a');
+        CHECK(!compressData(data.data(), size, compressed));
+    }
+
+    std::vector<unsigned char> empty;
+    CHECK(decompressData(nullptr, 0, empty.data(), 0));
+}
+
+static void testCompressibleData()
+{
+    CHECK(roundTrip(std::vector<unsigned char>(1024, 0)));
+    CHECK(roundTrip(std::vector<unsigned char>(100000, 0xff)));
+    CHECK(roundTrip(repeatedText(1024)));
+    CHECK(roundTrip(repeatedText(0x80000 - 1)));
+}
+
+static void testLengthBoundaries()
+{
+    // Literal runs and matches that need extra length bytes: 15, 15 + 255 and longer
+    for (std::size_t literals : {14u, 15u, 16u, 269u, 270u, 271u, 600u}) {
+        for (std::size_t match : {4u, 18u, 19u, 20u, 273u, 274u, 275u, 1000u}) {
+            auto data = randomData(literals, static_cast<unsigned>(literals));
+            const auto block = data;
+            // Repeat the beginning to produce a match of requested length after literals
+            for (std::size_t i = 0; i < match; ++i) {
+                data.push_back(block[i % block.size()]);
+            }
+
+            const auto tail = randomData(32, 1);
+            data.insert(data.end(), tail.begin(), tail.end());
+
+            std::vector<unsigned char> compressed;
+            const auto size = static_cast<std::uint32_t>(data.size());
+            if (compressData(data.data(), size, compressed)) {
+                std::vector<unsigned char> result(data.size());
+                CHECK(decompressData(compressed.data(),
+                                     static_cast<std::uint32_t>(compressed.size()), result.data(),
+                                     size));
+                CHECK(result == data);
+            }
+        }
+    }
+}
+
+static void testFarMatches()
+{
+    // Repetition further than maximum offset can not be referenced
+    const auto block = randomData(70000, 7);
+    auto data = block;
+    data.insert(data.end(), block.begin(), block.end());
+
+    std::vector<unsigned char> compressed;
+    CHECK(!compressData(data.data(), static_cast<std::uint32_t>(data.size()), compressed));
+
+    // Near repetition is found
+    const auto nearBlock = randomData(2000, 8);
+    data = nearBlock;
+    data.insert(data.end(), nearBlock.begin(), nearBlock.end());
+    CHECK(roundTrip(data));
+}
+
+static void testIncompressibleData()
+{
+    const auto data = randomData(4096, 3);
+
+    std::vector<unsigned char> compressed;
+    CHECK(!compressData(data.data(), static_cast<std::uint32_t>(data.size()), compressed));
+}
+
+static void testMalformedData()
+{
+    const auto data = repeatedText(4096);
+
+    std::vector<unsigned char> compressed;
+    CHECK(compressData(data.data(), static_cast<std::uint32_t>(data.size()), compressed));
+
+    const auto compressedSize = static_cast<std::uint32_t>(compressed.size());
+    std::vector<unsigned char> result(data.size() + 1);
+
+    // Expected size should match exactly
+    CHECK(!decompressData(compressed.data(), compressedSize, result.data(), 4095));
+    CHECK(!decompressData(compressed.data(), compressedSize, result.data(), 4097));
+
+    // Truncated data is rejected
+    for (std::uint32_t size = 0; size < compressedSize; ++size) {
+        CHECK(!decompressData(compressed.data(), size, result.data(), 4096));
+    }
+
+    // Zero offset and offset pointing before the beginning of output
+    const unsigned char zeroOffset[] = {0x10, 'a', 0x00, 0x00, 0x10, 'b'};
+    CHECK(!decompressData(zeroOffset, sizeof(zeroOffset), result.data(), 6));
+
+    const unsigned char farOffset[] = {0x10, 'a', 0x02, 0x00, 0x10, 'b'};
+    CHECK(!decompressData(farOffset, sizeof(farOffset), result.data(), 6));
+
+    // Overlapping match repeats the last byte
+    const unsigned char overlapping[] = {0x10, 'a', 0x01, 0x00, 0x10, 'b'};
+    CHECK(decompressData(overlapping, sizeof(overlapping), result.data(), 6));
+    CHECK(std::memcmp(result.data(), "aaaaab", 6) == 0);
+
+    // Literals count continues past the end of data
+    const unsigned char longLiterals[] = {0xf0, 0xff};
+    CHECK(!decompressData(longLiterals, sizeof(longLiterals), result.data(), 270));
+}
+
+static void testRandomRoundTrips()
+{
+    std::mt19937 random{11};
+    for (int i = 0; i < 200; ++i) {
+        // Mix of random bytes and repeated fragments of different lengths and distances
+        std::vector<unsigned char> data;
+        const auto size = 64 + random() % 20000;
+        while (data.size() < size) {
+            if (data.size() > 16 && random() % 2) {
+                const auto distance = 1 + random() % data.size();
+                const auto length = 1 + random() % 300;
+                const auto start = data.size() - distance;
+                for (std::size_t j = 0; j < length; ++j) {
+                    data.push_back(data[start + j]);
+                }
+            } else {
+                const auto length = 1 + random() % 40;
+                for (std::size_t j = 0; j < length; ++j) {
+                    data.push_back(static_cast<unsigned char>(random() % 8));
+                }
+            }
+        }
+
+        std::vector<unsigned char> compressed;
+        const auto dataSize = static_cast<std::uint32_t>(data.size());
+        if (compressData(data.data(), dataSize, compressed)) {
+            std::vector<unsigned char> result(data.size());
+            CHECK(decompressData(compressed.data(), static_cast<std::uint32_t>(compressed.size()),
+                                 result.data(), dataSize));
+            CHECK(result == data);
+        }
+    }
+}
+
+int main()
+{
+    RUN_TEST(testSmallInputs);
+    RUN_TEST(testCompressibleData);
+    RUN_TEST(testLengthBoundaries);
+    RUN_TEST(testFarMatches);
+    RUN_TEST(testIncompressibleData);
+    RUN_TEST(testMalformedData);
+    RUN_TEST(testRandomRoundTrips);
+
+    return tests::failedChecks() ? 1 : 0;
+}
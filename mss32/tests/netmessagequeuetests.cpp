@@ -0,0 +1,259 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "netmessageheader.h"
+#include "netmessagequeue.h"
+#include "testcheck.h"
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace hooks;
+
+/** Creates game message of specified length with payload derived from its sequence number. */
+static std::vector<unsigned char> createMessage(std::uint32_t length, std::uint32_t sequence)
+{
+    std::vector<unsigned char> data(length);
+
+    game::NetMessageHeader header{};
+    header.messageType = game::netMessageNormalType;
+    header.length = length;
+    std::strcpy(header.messageClassName, "TestMessage");
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    for (std::uint32_t i = sizeof(header); i < length; ++i) {
+        data[i] = static_cast<unsigned char>(sequence * 31 + i);
+    }
+
+    return data;
+}
+
+static const game::NetMessageHeader* asMessage(const std::vector<unsigned char>& data)
+{
+    return reinterpret_cast<const game::NetMessageHeader*>(data.data());
+}
+
+static bool isSameMessage(const game::NetMessageHeader* message,
+                          const std::vector<unsigned char>& expected)
+{
+    return message && message->length == expected.size()
+           && std::memcmp(message, expected.data(), expected.size()) == 0;
+}
+
+static void testEmptyQueue()
+{
+    NetMessageQueue queue;
+
+    std::uint32_t idFrom{};
+    CHECK(queue.front(idFrom) == nullptr);
+    CHECK(queue.size() == 0);
+
+    // Popping empty queue does nothing
+    queue.pop();
+    CHECK(queue.size() == 0);
+}
+
+static void testRoundTrip()
+{
+    NetMessageQueue queue;
+
+    const auto message = createMessage(100, 1);
+    queue.push(42, asMessage(message));
+    CHECK(queue.size() == 1);
+
+    std::uint32_t idFrom{};
+    std::uint32_t pushTime{};
+    CHECK(isSameMessage(queue.front(idFrom, &pushTime), message));
+    CHECK(idFrom == 42);
+
+    // Front does not remove the message
+    CHECK(isSameMessage(queue.front(idFrom), message));
+    CHECK(queue.size() == 1);
+
+    queue.pop();
+    CHECK(queue.size() == 0);
+    CHECK(queue.front(idFrom) == nullptr);
+}
+
+static void testMessageLengths()
+{
+    NetMessageQueue queue;
+
+    // Lengths around record alignment and the largest allowed message
+    const std::uint32_t lengths[] = {sizeof(game::NetMessageHeader),
+                                     sizeof(game::NetMessageHeader) + 1,
+                                     47,
+                                     48,
+                                     49,
+                                     64,
+                                     game::netMessageMaxLength - 1};
+
+    std::uint32_t sequence{};
+    for (auto length : lengths) {
+        const auto message = createMessage(length, sequence);
+        queue.push(sequence, asMessage(message));
+
+        std::uint32_t idFrom{};
+        CHECK(isSameMessage(queue.front(idFrom), message));
+        CHECK(idFrom == sequence);
+        queue.pop();
+        ++sequence;
+    }
+
+    CHECK(queue.size() == 0);
+}
+
+static void testWrapAround()
+{
+    NetMessageQueue queue;
+
+    // Messages are not multiples of ring capacity, so records wrap around with padding
+    std::uint32_t pushed{};
+    std::uint32_t popped{};
+    for (int round = 0; round < 64; ++round) {
+        for (int i = 0; i < 3; ++i, ++pushed) {
+            const auto message = createMessage(100000 + pushed * 7, pushed);
+            queue.push(pushed, asMessage(message));
+        }
+
+        for (int i = 0; i < 3; ++i, ++popped) {
+            std::uint32_t idFrom{};
+            const auto expected = createMessage(100000 + popped * 7, popped);
+            CHECK(isSameMessage(queue.front(idFrom), expected));
+            CHECK(idFrom == popped);
+            queue.pop();
+        }
+    }
+
+    CHECK(queue.size() == 0);
+}
+
+static void testOverflowKeepsOrder()
+{
+    NetMessageQueue queue;
+
+    // Ring buffer fits only a few of such messages, the rest go to overflow list
+    constexpr std::uint32_t length{game::netMessageMaxLength / 3};
+    constexpr std::uint32_t count{16};
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const auto message = createMessage(length + i, i);
+        queue.push(i, asMessage(message));
+    }
+
+    CHECK(queue.size() == count);
+
+    // Push more after consumer started reading, they should still come last
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::uint32_t idFrom{};
+        const auto expected = createMessage(length + i, i);
+        CHECK(isSameMessage(queue.front(idFrom), expected));
+        CHECK(idFrom == i);
+        queue.pop();
+
+        if (i == count / 2) {
+            const auto message = createMessage(length, count);
+            queue.push(count, asMessage(message));
+        }
+    }
+
+    std::uint32_t idFrom{};
+    CHECK(isSameMessage(queue.front(idFrom), createMessage(length, count)));
+    CHECK(idFrom == count);
+    queue.pop();
+
+    CHECK(queue.size() == 0);
+    CHECK(queue.front(idFrom) == nullptr);
+}
+
+static void testProducerConsumer()
+{
+    NetMessageQueue queue;
+
+    constexpr std::uint32_t count{20000};
+    const auto lengthOf = [](std::uint32_t sequence) {
+        // Mostly small messages with a large one from time to time to cause overflows
+        return sequence % 97 == 0 ? 200000 + sequence : 44 + sequence % 300;
+    };
+
+    std::thread producer([&queue, &lengthOf]() {
+        for (std::uint32_t i = 0; i < count; ++i) {
+            const auto message = createMessage(lengthOf(i), i);
+            queue.push(i, asMessage(message));
+        }
+    });
+
+    std::uint32_t received{};
+    bool ordered{true};
+    while (received < count) {
+        std::uint32_t idFrom{};
+        const auto message = queue.front(idFrom);
+        if (!message) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ordered &= idFrom == received
+                   && isSameMessage(message, createMessage(lengthOf(received), received));
+        queue.pop();
+        ++received;
+    }
+
+    producer.join();
+
+    CHECK(ordered);
+    CHECK(queue.size() == 0);
+}
+
+static void testMessageLengthValidation()
+{
+    const auto message = createMessage(100, 0);
+    const auto header = asMessage(message);
+
+    CHECK(isNetMessageLengthValid(header, 100));
+    CHECK(isNetMessageLengthValid(header, 200));
+    // Message is longer than received packet
+    CHECK(!isNetMessageLengthValid(header, 99));
+    // Packet is too short to contain a header
+    CHECK(!isNetMessageLengthValid(header, sizeof(game::NetMessageHeader) - 1));
+
+    auto invalid = message;
+    auto invalidHeader = reinterpret_cast<game::NetMessageHeader*>(invalid.data());
+
+    invalidHeader->length = sizeof(game::NetMessageHeader) - 1;
+    CHECK(!isNetMessageLengthValid(invalidHeader, 100));
+
+    invalidHeader->length = game::netMessageMaxLength;
+    CHECK(!isNetMessageLengthValid(invalidHeader, game::netMessageMaxLength));
+
+    invalidHeader->length = game::netMessageMaxLength - 1;
+    CHECK(isNetMessageLengthValid(invalidHeader, game::netMessageMaxLength));
+}
+
+int main()
+{
+    RUN_TEST(testEmptyQueue);
+    RUN_TEST(testRoundTrip);
+    RUN_TEST(testMessageLengths);
+    RUN_TEST(testWrapAround);
+    RUN_TEST(testOverflowKeepsOrder);
+    RUN_TEST(testProducerConsumer);
+    RUN_TEST(testMessageLengthValidation);
+
+    return tests::failedChecks() ? 1 : 0;
+}
@@ -0,0 +1,729 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Headless load test of custom lobby transport.
+ * Runs player server and scripted player clients in one process over loopback.
+ * Clients send game messages at a fixed rate, server puts them into receive queue
+ * the way player server does and its game thread relays them back.
+ * Messages are encoded with the same batching and compression as NetMessageBatcher.
+ * Reports delivered messages per second, latency percentiles, wire traffic and memory.
+ */
+
+#include "datacompression.h"
+#include "netcompression.h"
+#include "netmessageheader.h"
+#include "netmessagequeue.h"
+#include "netplayermessages.h"
+#include <RakPeerInterface.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace hooks;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options
+{
+    std::uint32_t clients{8};
+    std::uint32_t seconds{10};
+    /** Messages sent by each client per second. */
+    std::uint32_t rate{200};
+    /** Every n-th message is large, like battle or scenario messages. */
+    std::uint32_t largeEvery{50};
+    std::uint32_t largeLength{20000};
+    std::uint16_t port{60100};
+    /** Server relays each message to every client instead of its sender only. */
+    bool broadcast{};
+    std::uint8_t features{PlayerFeatures::Compression | PlayerFeatures::Batching};
+};
+
+/** Data of simulated game message that follows its header. */
+struct Payload
+{
+    std::uint32_t client;
+    std::uint32_t sequence;
+    std::int64_t sendTime;
+};
+
+/** Hello message sent by client once connected, tells its index to the server. */
+static constexpr std::uint32_t helloSequence{0xffffffff};
+
+struct PeerDeleter
+{
+    void operator()(SLNet::RakPeerInterface* peer)
+    {
+        peer->Shutdown(100);
+        SLNet::RakPeerInterface::DestroyInstance(peer);
+    }
+};
+
+using PeerPtr = std::unique_ptr<SLNet::RakPeerInterface, PeerDeleter>;
+
+std::int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               Clock::now().time_since_epoch())
+        .count();
+}
+
+std::vector<unsigned char> createMessage(std::uint32_t client,
+                                         std::uint32_t sequence,
+                                         std::uint32_t length)
+{
+    std::vector<unsigned char> data(length);
+
+    game::NetMessageHeader header{};
+    header.messageType = game::netMessageNormalType;
+    header.length = length;
+    std::strcpy(header.messageClassName, ".?AVCSimulatedMsg@@");
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    // Imitate serialized game objects: ids and small numbers that compress well
+    for (std::uint32_t i = sizeof(header) + sizeof(Payload); i < length; ++i) {
+        data[i] = static_cast<unsigned char>((i % 16) < 4 ? 'S' + (i / 16) % 8 : i % 5);
+    }
+
+    const Payload payload{client, sequence, now()};
+    std::memcpy(&data[sizeof(header)], &payload, sizeof(payload));
+    return data;
+}
+
+Payload readPayload(const game::NetMessageHeader* message)
+{
+    Payload payload;
+    std::memcpy(&payload, reinterpret_cast<const unsigned char*>(message) + sizeof(*message),
+                sizeof(payload));
+    return payload;
+}
+
+/** Encodes game messages for a single target like NetMessageBatcher and sendGameMessage. */
+class Sender
+{
+public:
+    Sender(SLNet::RakPeerInterface* peer, const SLNet::AddressOrGUID& target, std::uint8_t features)
+        : peer{peer}
+        , target{target}
+        , features{features}
+    {
+        batch.reserve(netBatchMaxLength);
+    }
+
+    void send(const game::NetMessageHeader* message)
+    {
+        if (!(features & PlayerFeatures::Batching) || message->length >= netBatchMaxLength) {
+            flush();
+            sendMessage(message);
+            return;
+        }
+
+        if (batch.size() + message->length > netBatchMaxLength) {
+            flush();
+        }
+
+        if (batch.empty()) {
+            batch.push_back(static_cast<unsigned char>(ID_PLAYER_BATCHED_MESSAGES));
+        }
+
+        const auto data{reinterpret_cast<const unsigned char*>(message)};
+        batch.insert(batch.end(), data, data + message->length);
+        ++batchMessages;
+    }
+
+    void flush()
+    {
+        if (batchMessages == 1) {
+            sendMessage(reinterpret_cast<const game::NetMessageHeader*>(&batch[1]));
+        } else if (batchMessages > 1) {
+            sendPacket(batch.data(), static_cast<std::uint32_t>(batch.size()));
+        }
+
+        batch.clear();
+        batchMessages = 0;
+    }
+
+    std::uint64_t packets{};
+    std::uint64_t bytes{};
+
+private:
+    void sendMessage(const game::NetMessageHeader* message)
+    {
+        const auto data{reinterpret_cast<const unsigned char*>(message)};
+
+        if ((features & PlayerFeatures::Compression) && message->length >= netCompressionThreshold
+            && compressData(data, message->length, compressed)) {
+            std::vector<unsigned char> packet(1 + sizeof(message->length));
+            packet[0] = static_cast<unsigned char>(ID_PLAYER_COMPRESSED_MESSAGE);
+            std::memcpy(&packet[1], &message->length, sizeof(message->length));
+            packet.insert(packet.end(), compressed.begin(), compressed.end());
+
+            sendPacket(packet.data(), static_cast<std::uint32_t>(packet.size()));
+            return;
+        }
+
+        sendPacket(data, message->length);
+    }
+
+    void sendPacket(const unsigned char* data, std::uint32_t length)
+    {
+        peer->Send(reinterpret_cast<const char*>(data), static_cast<int>(length),
+                   PacketPriority::HIGH_PRIORITY, PacketReliability::RELIABLE_ORDERED, 0, target,
+                   false);
+        ++packets;
+        bytes += length;
+    }
+
+    SLNet::RakPeerInterface* peer;
+    SLNet::AddressOrGUID target;
+    std::vector<unsigned char> batch;
+    std::vector<unsigned char> compressed;
+    std::uint32_t batchMessages{};
+    std::uint8_t features;
+};
+
+/**
+ * Calls function for each game message of the packet.
+ * Handles packets the same way as player client and server do.
+ */
+template <typename T>
+void forEachMessage(const SLNet::Packet* packet, std::vector<unsigned char>& buffer, T&& function)
+{
+    if (!packet->length) {
+        return;
+    }
+
+    if (packet->data[0] == ID_PLAYER_BATCHED_MESSAGES) {
+        std::uint32_t offset{1};
+        while (auto message = readBatchedMessage(packet->data, packet->length, offset)) {
+            function(message);
+        }
+
+        return;
+    }
+
+    if (packet->data[0] == ID_PLAYER_COMPRESSED_MESSAGE) {
+        constexpr std::uint32_t headerSize{1 + sizeof(std::uint32_t)};
+        if (packet->length < headerSize) {
+            return;
+        }
+
+        std::uint32_t length{};
+        std::memcpy(&length, packet->data + 1, sizeof(length));
+        if (length < sizeof(game::NetMessageHeader) || length >= game::netMessageMaxLength) {
+            return;
+        }
+
+        buffer.resize(length);
+        if (decompressData(packet->data + headerSize, packet->length - headerSize, buffer.data(),
+                           length)) {
+            function(reinterpret_cast<const game::NetMessageHeader*>(buffer.data()));
+        }
+
+        return;
+    }
+
+    const auto message{reinterpret_cast<const game::NetMessageHeader*>(packet->data)};
+    if (isNetMessageLengthValid(message, packet->length)
+        && message->messageType == game::netMessageNormalType) {
+        function(message);
+    }
+}
+
+/** Player server: network thread queues received messages, game thread relays them. */
+class Server
+{
+public:
+    Server(const Options& options)
+        : options{options}
+        , guids(options.clients, SLNet::UNASSIGNED_RAKNET_GUID)
+    { }
+
+    ~Server()
+    {
+        stop();
+    }
+
+    bool start()
+    {
+        peer.reset(SLNet::RakPeerInterface::GetInstance());
+
+        SLNet::SocketDescriptor socket{options.port, nullptr};
+        const auto clients{static_cast<unsigned int>(options.clients)};
+        if (peer->Startup(clients, &socket, 1) != SLNet::RAKNET_STARTED) {
+            std::fprintf(stderr, "Failed to start server peer on port %u\n", options.port);
+            return false;
+        }
+
+        peer->SetMaximumIncomingConnections(static_cast<unsigned short>(clients));
+        networkThread = std::thread(&Server::runNetwork, this);
+        return true;
+    }
+
+    /** Starts relaying messages, all clients should be known. */
+    void startGame()
+    {
+        for (const auto& guid : guids) {
+            senders.emplace_back(peer.get(), guid, options.features);
+        }
+
+        gameThread = std::thread(&Server::runGame, this);
+    }
+
+    void stop()
+    {
+        running = false;
+        if (networkThread.joinable()) {
+            networkThread.join();
+        }
+
+        if (gameThread.joinable()) {
+            gameThread.join();
+        }
+    }
+
+    std::uint32_t knownClients() const
+    {
+        return known.load(std::memory_order_acquire);
+    }
+
+    std::uint64_t packets() const
+    {
+        std::uint64_t total{};
+        for (const auto& sender : senders) {
+            total += sender.packets;
+        }
+
+        return total;
+    }
+
+    std::uint64_t bytes() const
+    {
+        std::uint64_t total{};
+        for (const auto& sender : senders) {
+            total += sender.bytes;
+        }
+
+        return total;
+    }
+
+    std::uint32_t maxQueueSize{};
+
+private:
+    void runNetwork()
+    {
+        std::vector<unsigned char> buffer;
+
+        while (running) {
+            auto packet = peer->Receive();
+            if (!packet) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+
+            forEachMessage(packet, buffer, [this, packet](const game::NetMessageHeader* message) {
+                const auto payload{readPayload(message)};
+                if (payload.client >= guids.size()) {
+                    return;
+                }
+
+                if (payload.sequence == helloSequence) {
+                    // Guids are written only before game thread starts
+                    if (guids[payload.client] == SLNet::UNASSIGNED_RAKNET_GUID) {
+                        guids[payload.client] = packet->guid;
+                        known.fetch_add(1, std::memory_order_release);
+                    }
+
+                    return;
+                }
+
+                queue.push(payload.client, message);
+            });
+
+            peer->DeallocatePacket(packet);
+        }
+    }
+
+    void runGame()
+    {
+        while (running) {
+            maxQueueSize = std::max(maxQueueSize, queue.size());
+
+            bool relayed{};
+            std::uint32_t idFrom{};
+            while (auto message = queue.front(idFrom)) {
+                if (options.broadcast) {
+                    for (auto& sender : senders) {
+                        sender.send(message);
+                    }
+                } else {
+                    senders[idFrom].send(message);
+                }
+
+                queue.pop();
+                relayed = true;
+            }
+
+            // Like flush event processed when the game returns to its message loop
+            for (auto& sender : senders) {
+                sender.flush();
+            }
+
+            if (!relayed) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+
+    const Options& options;
+    PeerPtr peer;
+    NetMessageQueue queue;
+    std::vector<SLNet::RakNetGUID> guids;
+    std::vector<Sender> senders;
+    std::atomic<std::uint32_t> known{};
+    std::atomic<bool> running{true};
+    std::thread networkThread;
+    std::thread gameThread;
+};
+
+struct Client
+{
+    PeerPtr peer;
+    std::unique_ptr<Sender> sender;
+    std::uint32_t sent{};
+};
+
+/** Connects clients to the server, returns false if any of them failed to connect in time. */
+bool connectClients(std::vector<Client>& clients, const Options& options)
+{
+    for (auto& client : clients) {
+        client.peer.reset(SLNet::RakPeerInterface::GetInstance());
+
+        SLNet::SocketDescriptor socket{0, nullptr};
+        if (client.peer->Startup(1, &socket, 1) != SLNet::RAKNET_STARTED) {
+            std::fprintf(stderr, "Failed to start client peer\n");
+            return false;
+        }
+
+        if (client.peer->Connect("127.0.0.1", options.port, nullptr, 0)
+            != SLNet::CONNECTION_ATTEMPT_STARTED) {
+            std::fprintf(stderr, "Failed to start connection to server\n");
+            return false;
+        }
+    }
+
+    const auto deadline{Clock::now() + std::chrono::seconds(10)};
+    std::size_t connected{};
+    while (connected < clients.size() && Clock::now() < deadline) {
+        for (std::uint32_t i = 0; i < clients.size(); ++i) {
+            auto& client = clients[i];
+            if (client.sender) {
+                continue;
+            }
+
+            for (auto packet = client.peer->Receive(); packet; packet = client.peer->Receive()) {
+                if (packet->data[0] == ID_CONNECTION_REQUEST_ACCEPTED && !client.sender) {
+                    client.sender = std::make_unique<Sender>(client.peer.get(), packet->guid,
+                                                             options.features);
+
+                    const auto hello{createMessage(i, helloSequence, 64)};
+                    client.sender->send(
+                        reinterpret_cast<const game::NetMessageHeader*>(hello.data()));
+                    client.sender->flush();
+                    ++connected;
+                }
+
+                client.peer->DeallocatePacket(packet);
+            }
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (connected < clients.size()) {
+        std::fprintf(stderr, "Only %zu of %zu clients connected\n", connected, clients.size());
+        return false;
+    }
+
+    return true;
+}
+
+/** Receives relayed messages for all clients and measures their latency. */
+class Receiver
+{
+public:
+    Receiver(std::vector<Client>& clients)
+        : clients{clients}
+    { }
+
+    void start()
+    {
+        thread = std::thread(&Receiver::run, this);
+    }
+
+    void stop()
+    {
+        running = false;
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    std::uint64_t delivered() const
+    {
+        return deliveredCount.load(std::memory_order_acquire);
+    }
+
+    /** Latencies in microseconds, available after stop. */
+    std::vector<std::uint32_t> latencies;
+
+private:
+    void run()
+    {
+        std::vector<unsigned char> buffer;
+
+        while (running) {
+            bool received{};
+            for (auto& client : clients) {
+                for (auto packet = client.peer->Receive(); packet;
+                     packet = client.peer->Receive()) {
+                    forEachMessage(packet, buffer, [this](const game::NetMessageHeader* message) {
+                        const auto payload{readPayload(message)};
+                        latencies.push_back(
+                            static_cast<std::uint32_t>((now() - payload.sendTime) / 1000));
+                        deliveredCount.fetch_add(1, std::memory_order_release);
+                    });
+
+                    client.peer->DeallocatePacket(packet);
+                    received = true;
+                }
+            }
+
+            if (!received) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+
+    std::vector<Client>& clients;
+    std::atomic<std::uint64_t> deliveredCount{};
+    std::atomic<bool> running{true};
+    std::thread thread;
+};
+
+/** Sends messages of all clients at configured rate until time is out. */
+std::uint64_t runClients(std::vector<Client>& clients, const Options& options)
+{
+    const auto start{Clock::now()};
+    const auto end{start + std::chrono::seconds(options.seconds)};
+
+    std::uint64_t sent{};
+    for (auto time = start; time < end; time = Clock::now()) {
+        const std::chrono::duration<double> elapsed{time - start};
+        const auto due{static_cast<std::uint32_t>(elapsed.count() * options.rate)};
+
+        for (std::uint32_t i = 0; i < clients.size(); ++i) {
+            auto& client = clients[i];
+            for (; client.sent < due; ++client.sent, ++sent) {
+                const bool large{options.largeEvery && client.sent % options.largeEvery == 0};
+                const auto length{large ? options.largeLength : 60 + (client.sent * 37) % 200};
+
+                const auto message{createMessage(i, client.sent, length)};
+                client.sender->send(
+                    reinterpret_cast<const game::NetMessageHeader*>(message.data()));
+            }
+
+            client.sender->flush();
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return sent;
+}
+
+/** Returns value of field from /proc/self/status in kilobytes, 0 if not available. */
+std::uint64_t readMemoryStatus(const char* field)
+{
+    std::ifstream status{"/proc/self/status"};
+    std::string name;
+    while (status >> name) {
+        if (name == field) {
+            std::uint64_t value{};
+            status >> value;
+            return value;
+        }
+
+        status.ignore(256, '\n');
+    }
+
+    return 0;
+}
+
+std::uint32_t percentile(const std::vector<std::uint32_t>& sorted, double value)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+
+    const auto index{static_cast<std::size_t>(value * (sorted.size() - 1))};
+    return sorted[index];
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string name{argv[i]};
+        const bool hasValue{i + 1 < argc};
+
+        if (name == "--no-batching") {
+            options.features &= ~PlayerFeatures::Batching;
+        } else if (name == "--no-compression") {
+            options.features &= ~PlayerFeatures::Compression;
+        } else if (name == "--broadcast") {
+            options.broadcast = true;
+        } else if (hasValue && name == "--clients") {
+            options.clients = std::strtoul(argv[++i], nullptr, 10);
+        } else if (hasValue && name == "--seconds") {
+            options.seconds = std::strtoul(argv[++i], nullptr, 10);
+        } else if (hasValue && name == "--rate") {
+            options.rate = std::strtoul(argv[++i], nullptr, 10);
+        } else if (hasValue && name == "--large-every") {
+            options.largeEvery = std::strtoul(argv[++i], nullptr, 10);
+        } else if (hasValue && name == "--large-length") {
+            options.largeLength = std::strtoul(argv[++i], nullptr, 10);
+        } else if (hasValue && name == "--port") {
+            options.port = static_cast<std::uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            std::fprintf(stderr,
+                         "Usage: netsimulator [--clients N] [--seconds N] [--rate N]\n"
+                         "  [--large-every N] [--large-length N] [--port N]\n"
+                         "  [--broadcast] [--no-batching] [--no-compression]\n");
+            return false;
+        }
+    }
+
+    const auto minLength{static_cast<std::uint32_t>(sizeof(game::NetMessageHeader)
+                                                    + sizeof(Payload))};
+    if (!options.clients || options.largeLength < minLength
+        || options.largeLength >= game::netMessageMaxLength) {
+        std::fprintf(stderr, "Invalid options\n");
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    Server server{options};
+    if (!server.start()) {
+        return 1;
+    }
+
+    std::vector<Client> clients(options.clients);
+    if (!connectClients(clients, options)) {
+        return 1;
+    }
+
+    const auto deadline{Clock::now() + std::chrono::seconds(10)};
+    while (server.knownClients() < options.clients && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (server.knownClients() < options.clients) {
+        std::fprintf(stderr, "Server did not receive hello from all clients\n");
+        return 1;
+    }
+
+    server.startGame();
+
+    Receiver receiver{clients};
+    receiver.start();
+
+    const auto memoryBefore{readMemoryStatus("VmRSS:")};
+    const auto start{Clock::now()};
+    const auto sent{runClients(clients, options)};
+
+    // Wait for messages that are still in flight
+    const auto expected{options.broadcast ? sent * options.clients : sent};
+    const auto drainDeadline{Clock::now() + std::chrono::seconds(5)};
+    while (receiver.delivered() < expected && Clock::now() < drainDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    const std::chrono::duration<double> duration{Clock::now() - start};
+    receiver.stop();
+    server.stop();
+
+    std::uint64_t clientPackets{};
+    std::uint64_t clientBytes{};
+    for (const auto& client : clients) {
+        clientPackets += client.sender->packets;
+        clientBytes += client.sender->bytes;
+    }
+
+    auto latencies{std::move(receiver.latencies)};
+    std::sort(latencies.begin(), latencies.end());
+
+    const auto delivered{receiver.delivered()};
+    std::printf("clients: %u, rate: %u msg/s per client, large every %u (%u bytes), %s\n",
+                options.clients, options.rate, options.largeEvery, options.largeLength,
+                options.broadcast ? "broadcast" : "echo");
+    std::printf("batching: %s, compression: %s\n",
+                options.features & PlayerFeatures::Batching ? "on" : "off",
+                options.features & PlayerFeatures::Compression ? "on" : "off");
+    std::printf("sent: %llu, delivered: %llu of %llu, duration: %.2f s\n",
+                static_cast<unsigned long long>(sent), static_cast<unsigned long long>(delivered),
+                static_cast<unsigned long long>(expected), duration.count());
+    std::printf("throughput: %.0f delivered messages/s\n", delivered / duration.count());
+    std::printf("latency us: p50 %u, p90 %u, p99 %u, p99.9 %u, max %u\n",
+                percentile(latencies, 0.5), percentile(latencies, 0.9),
+                percentile(latencies, 0.99), percentile(latencies, 0.999),
+                latencies.empty() ? 0 : latencies.back());
+    std::printf("client to server: %llu packets, %llu bytes; server to clients: %llu packets, "
+                "%llu bytes\n",
+                static_cast<unsigned long long>(clientPackets),
+                static_cast<unsigned long long>(clientBytes),
+                static_cast<unsigned long long>(server.packets()),
+                static_cast<unsigned long long>(server.bytes()));
+    std::printf("server queue: max %u messages\n", server.maxQueueSize);
+    std::printf("memory: peak rss %llu kB, rss growth during load %lld kB\n",
+                static_cast<unsigned long long>(readMemoryStatus("VmHWM:")),
+                static_cast<long long>(readMemoryStatus("VmRSS:"))
+                    - static_cast<long long>(memoryBefore));
+
+    return delivered == expected ? 0 : 1;
+}
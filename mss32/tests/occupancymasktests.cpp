@@ -0,0 +1,125 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "occupancymask.h"
+#include "testcheck.h"
+#include <random>
+#include <vector>
+
+using namespace hooks;
+
+/** Number of modified units slots, see ModifiedUnitCountPatched. */
+static constexpr std::size_t slotsCount{48};
+
+static std::vector<unsigned long> setBits(std::uint64_t mask)
+{
+    std::vector<unsigned long> indices;
+    forEachSetBit(mask, [&indices](unsigned long index) { indices.push_back(index); });
+    return indices;
+}
+
+static std::vector<unsigned long> setBitsNaive(std::uint64_t mask)
+{
+    std::vector<unsigned long> indices;
+    for (unsigned long i = 0; i < 64; ++i) {
+        if (mask & (std::uint64_t{1} << i)) {
+            indices.push_back(i);
+        }
+    }
+
+    return indices;
+}
+
+static void testLowestSetBit()
+{
+    // Bits in both halves of the mask
+    for (unsigned long i = 0; i < 64; ++i) {
+        const auto bit = std::uint64_t{1} << i;
+        CHECK(getLowestSetBit(bit) == i);
+        CHECK(getLowestSetBit(bit | (std::uint64_t{1} << 63)) == i);
+    }
+
+    CHECK(getLowestSetBit(~std::uint64_t{}) == 0);
+    CHECK(getLowestSetBit(0xffffffff00000000ull) == 32);
+}
+
+static void testFullMask()
+{
+    CHECK(getFullMask(0) == 0);
+    CHECK(getFullMask(1) == 1);
+    CHECK(getFullMask(slotsCount) == 0xffffffffffffull);
+    CHECK(getFullMask(63) == 0x7fffffffffffffffull);
+    CHECK(getFullMask(64) == ~std::uint64_t{});
+}
+
+static void testIteration()
+{
+    CHECK(setBits(0).empty());
+    CHECK((setBits(1) == std::vector<unsigned long>{0}));
+    CHECK((setBits(0x8000000000000001ull) == std::vector<unsigned long>{0, 63}));
+    CHECK((setBits(0x0000000180000000ull) == std::vector<unsigned long>{31, 32}));
+    CHECK(setBits(getFullMask(slotsCount)).size() == slotsCount);
+
+    std::mt19937_64 random{5};
+    for (int i = 0; i < 10000; ++i) {
+        // Sparse and dense masks
+        auto mask = random();
+        if (i % 2) {
+            mask &= random() & random();
+        }
+
+        CHECK(setBits(mask) == setBitsNaive(mask));
+    }
+}
+
+static void testFreeSlots()
+{
+    CHECK(findFreeSlot(0, slotsCount) == 0);
+    CHECK(findFreeSlot(0b1011, slotsCount) == 2);
+    CHECK(findFreeSlot(getFullMask(40), slotsCount) == 40);
+    CHECK(findFreeSlot(getFullMask(slotsCount - 1), slotsCount) == slotsCount - 1);
+
+    // Bits above slots count are not slots
+    CHECK(findFreeSlot(getFullMask(slotsCount), slotsCount) == slotsCount);
+    CHECK(findFreeSlot(~std::uint64_t{}, slotsCount) == slotsCount);
+    CHECK(findFreeSlot(~std::uint64_t{}, 64) == 64);
+
+    // Filling slots one by one takes them in order, freed slot is reused first
+    std::uint64_t occupancy{};
+    for (std::size_t i = 0; i < slotsCount; ++i) {
+        const auto index = findFreeSlot(occupancy, slotsCount);
+        CHECK(index == i);
+        occupancy |= std::uint64_t{1} << index;
+    }
+
+    CHECK(findFreeSlot(occupancy, slotsCount) == slotsCount);
+
+    occupancy &= ~(std::uint64_t{1} << 17);
+    CHECK(findFreeSlot(occupancy, slotsCount) == 17);
+}
+
+int main()
+{
+    RUN_TEST(testLowestSetBit);
+    RUN_TEST(testFullMask);
+    RUN_TEST(testIteration);
+    RUN_TEST(testFreeSlots);
+
+    return tests::failedChecks() ? 1 : 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * This file is part of the modding toolset for Disciples 2.
+ * (https://github.com/VladimirMakeev/D2ModdingToolset)
+ * Copyright (C) 2024 Vladimir Makeev.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "netstatistics.h"
+#include <chrono>
+
+namespace hooks {
+
+// Statistics are not collected in tests, only timestamps are needed
+std::uint32_t netTimestamp()
+{
+    using namespace std::chrono;
+
+    const auto now = steady_clock::now().time_since_epoch();
+    return static_cast<std::uint32_t>(duration_cast<microseconds>(now).count());
+}
+
+void netStatisticsMessageSent(const game::NetMessageHeader*, std::uint32_t)
+{ }
+
+void netStatisticsMessageReceived(const game::NetMessageHeader*, std::uint32_t, std::uint32_t)
+{ }
+
+void netStatisticsMessageDequeued(const game::NetMessageHeader*, std::uint32_t)
+{ }
+
+void netStatisticsDump()
+{ }
+
+} // namespace hooks